@@ -0,0 +1,368 @@
+#ifndef TRIG_EFF_ACCEPTANCE_H
+#define TRIG_EFF_ACCEPTANCE_H
+
+// ==============================================================================
+//
+// Tabulated acceptance maps in 1-3 variables (e.g. p, the, phi) for the toy MC.
+//
+// The input table (a ROOT histogram or a text table, possibly with non-uniform
+// binning) is resampled once into a flat, uniform lookup grid. Evaluation is
+// then pure index arithmetic: no binary search over bin edges and no branches
+// on the coordinates (values outside the table are clamped to the edge).
+//
+//   BINNED: piecewise constant, the value of the bin containing the point
+//           (histograms from the detector simulation)
+//   GRID  : multi-linear interpolation between grid nodes (gridded tables)
+//
+// Text table format ('#' starts a comment):
+//
+//   mode  GRID                          (or BINNED)
+//   axis  p    uniform 11 0.0 5.0       (n nodes/bins edges, min, max)
+//   axis  the  edges   0.0 0.5 2.64 3.14159   (explicit node/bin-edge positions)
+//   values v0 v1 v2 ...                 (row-major, last axis fastest)
+//
+// For GRID the values are given at the nodes, for BINNED one value per bin.
+//
+// eval_batch() is written for the auto-vectoriser: compiled with e.g.
+// gSystem->SetFlagsOpt("-O3 -march=native") it evaluates several tracks per
+// instruction (the table lookups become gathers).
+//
+// ==============================================================================
+
+#include <TH1.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// ==============================================================================
+
+class AccMap {
+
+public:
+
+  enum Mode { BINNED, GRID };
+
+  AccMap() : mode(GRID), n_dim(0) {}
+
+  bool is_loaded() const { return n_dim > 0; }
+
+  // ---------------------------------------------------------------------------
+
+  // binned acceptance from a TH1/TH2/TH3. Axes with fixed bin widths are
+  // used as they are; variable-width axes are resampled into n_fine cells
+  // (0 == default_fine(), should resolve the narrowest input bin)
+
+  bool load_hist(TH1* hist, int n_fine = 0) {
+
+    if(!hist) {
+      std::cout << "AccMap: ERROR: no acceptance histogram" << std::endl;
+      return false;
+    }
+
+    mode  = BINNED;
+    n_dim = hist->GetDimension();
+
+    TAxis* axes[3] = {hist->GetXaxis(), hist->GetYaxis(), hist->GetZaxis()};
+
+    if(n_fine <= 0) n_fine = default_fine();
+
+    for(int d = 0; d < n_dim; d++) {
+      bool uniform = (axes[d]->GetXbins()->GetSize() == 0);
+      set_axis(d, uniform ? axes[d]->GetNbins() : n_fine, axes[d]->GetXmin(), axes[d]->GetXmax());
+    }
+
+    // the only bin searches: once per lookup cell, at the cell centre
+
+    std::vector<double> x(3, 0.0);
+
+    table.resize(n_cells());
+    for(long c = 0; c < n_cells(); c++) {
+      lookup_point(c, x.data());
+      int bin = hist->FindFixBin(x[0], x[1], x[2]);
+      table[c] = hist->GetBinContent(bin);
+    }
+
+    print();
+    return true;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  // text table (format above)
+
+  bool load_text(std::string file_name, int n_fine = 0) {
+
+    std::ifstream in_file(file_name.c_str());
+
+    if(!in_file) {
+      std::cout << "AccMap: ERROR: cannot open acceptance table = " << file_name << std::endl;
+      return false;
+    }
+
+    std::string line, key, word;
+    std::vector< std::vector<double> > nodes;
+    std::vector<double> values;
+    double v;
+
+    mode = GRID;
+
+    while(getline(in_file, line)) {
+
+      line = line.substr(0, line.find('#'));
+      std::istringstream items(line);
+
+      if(!(items >> key)) continue;
+
+      if(key == "mode") {
+
+	items >> word;
+	mode = (word == "BINNED") ? BINNED : GRID;
+
+      } else if(key == "axis") {
+
+	std::vector<double> pos;
+	items >> word >> word; // name, kind
+
+	if(word == "uniform") {
+	  int n;
+	  double lo, hi;
+	  items >> n >> lo >> hi;
+	  for(int i = 0; i < n; i++) pos.push_back(lo + (hi - lo)*i/(n - 1));
+	} else {
+	  while(items >> v) pos.push_back(v);
+	}
+	nodes.push_back(pos);
+
+      } else if(key == "values") {
+
+	while(items >> v) values.push_back(v);
+	while(in_file >> v) values.push_back(v);
+
+      }
+    }
+
+    n_dim = nodes.size();
+
+    if(n_dim < 1 || n_dim > 3) {
+      std::cout << "AccMap: ERROR: " << file_name << ": 1-3 axes needed" << std::endl;
+      n_dim = 0;
+      return false;
+    }
+
+    // expected number of values: nodes (GRID) or bins (BINNED) per axis
+
+    size_t n_expected = 1;
+    for(int d = 0; d < n_dim; d++) {
+      if(nodes[d].size() < 2) {
+	std::cout << "AccMap: ERROR: " << file_name << ": axis " << d << " needs >= 2 positions" << std::endl;
+	n_dim = 0;
+	return false;
+      }
+      n_expected *= nodes[d].size() - (mode == BINNED ? 1 : 0);
+    }
+
+    if(values.size() != n_expected) {
+      std::cout << "AccMap: ERROR: " << file_name << ": " << values.size()
+		<< " values, expected " << n_expected << std::endl;
+      n_dim = 0;
+      return false;
+    }
+
+    // resample onto the uniform lookup grid: uniform table axes are kept as
+    // they are (exact), non-uniform ones get n_fine nodes (GRID, interpolated
+    // from the table nodes) or n_fine cells (BINNED, value of the table bin
+    // of the cell centre)
+
+    if(n_fine <= 0) n_fine = default_fine();
+
+    for(int d = 0; d < n_dim; d++) {
+      const std::vector<double>& pos = nodes[d];
+      double step = (pos.back() - pos.front())/(pos.size() - 1);
+      bool uniform = true;
+      for(size_t i = 1; i < pos.size(); i++) {
+	if(fabs(pos[i] - pos[i-1] - step) > 1e-6*step) uniform = false;
+      }
+      int n_table = (mode == GRID) ? pos.size() : pos.size() - 1;
+      set_axis(d, uniform ? n_table : n_fine, pos.front(), pos.back());
+    }
+
+    std::vector<double> x(3, 0.0);
+
+    table.resize(n_cells());
+    for(long c = 0; c < n_cells(); c++) {
+
+      lookup_point(c, x.data());
+
+      // table value: multi-linear in the (non-uniform) table cell of x
+
+      long   stride[3];
+      int    i_lo[3];
+      double frac[3];
+
+      long s = 1;
+      for(int d = n_dim - 1; d >= 0; d--) {
+	const std::vector<double>& pos = nodes[d];
+	int n_pos = pos.size();
+	int i = std::upper_bound(pos.begin(), pos.end(), x[d]) - pos.begin() - 1;
+	i = std::max(0, std::min(i, n_pos - 2));
+	i_lo[d]   = i;
+	frac[d]   = (mode == GRID) ? (x[d] - pos[i])/(pos[i+1] - pos[i]) : 0.0;
+	frac[d]   = std::max(0.0, std::min(1.0, frac[d]));
+	stride[d] = s;
+	s *= (mode == GRID) ? n_pos : n_pos - 1;
+      }
+
+      double val = 0.0;
+      for(int corner = 0; corner < (1 << n_dim); corner++) {
+	double w = 1.0;
+	long   k = 0;
+	for(int d = 0; d < n_dim; d++) {
+	  int up = (corner >> d) & 1;
+	  w *= up ? frac[d] : 1.0 - frac[d];
+	  k += (i_lo[d] + up)*stride[d];
+	}
+	if(w > 0.0) val += w*values[k];
+      }
+      table[c] = val;
+    }
+
+    print();
+    return true;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  // acceptance at x[0..n_dim-1]
+
+  double eval(const double* x) const {
+    return (mode == GRID) ? eval_grid(x) : eval_binned(x);
+  }
+
+  // acceptance for n tracks, coordinates as separate arrays x[d][i]
+
+  void eval_batch(int n_trk, const float* const* x, float* acc) const {
+
+    if(mode == BINNED) {
+
+      const float* x0 = x[0];
+      const float* x1 = (n_dim > 1) ? x[1] : x[0];
+      const float* x2 = (n_dim > 2) ? x[2] : x[0];
+
+      for(int i = 0; i < n_trk; i++) {
+	long c = cell_index(0, x0[i]);
+	if(n_dim > 1) c = c*n[1] + cell_index(1, x1[i]);
+	if(n_dim > 2) c = c*n[2] + cell_index(2, x2[i]);
+	acc[i] = table[c];
+      }
+
+    } else {
+
+      double xd[3];
+      for(int i = 0; i < n_trk; i++) {
+	for(int d = 0; d < n_dim; d++) xd[d] = x[d][i];
+	acc[i] = eval_grid(xd);
+      }
+
+    }
+  }
+
+  void print() const {
+    std::cout << "AccMap: " << (mode == GRID ? "GRID" : "BINNED") << ", " << n_dim << " axes,";
+    for(int d = 0; d < n_dim; d++) std::cout << " [" << lo[d] << "," << hi[d] << "]x" << n[d];
+    std::cout << ", " << table.size() << " lookup values" << std::endl;
+  }
+
+private:
+
+  Mode mode;
+  int  n_dim;
+
+  // uniform lookup grid per axis: n nodes (GRID) or cells (BINNED) over [lo, hi]
+
+  int    n[3];
+  double lo[3];
+  double hi[3];
+  double inv_step[3];
+
+  std::vector<float> table; // row-major, last axis fastest
+
+  // resampling granularity: ~2^24 lookup values at most (64 MB)
+
+  int default_fine() const { return (n_dim == 1) ? 4096 : (n_dim == 2) ? 1024 : 256; }
+
+  void set_axis(int d, int n_fine, double x_min, double x_max) {
+    n[d]  = n_fine;
+    lo[d] = x_min;
+    hi[d] = x_max;
+    inv_step[d] = (mode == GRID ? n_fine - 1 : n_fine)/(x_max - x_min);
+  }
+
+  long n_cells() const {
+    long nc = 1;
+    for(int d = 0; d < n_dim; d++) nc *= n[d];
+    return nc;
+  }
+
+  // coordinates of lookup node/cell centre c
+
+  void lookup_point(long c, double* x) const {
+    for(int d = n_dim - 1; d >= 0; d--) {
+      int i = c % n[d];
+      c /= n[d];
+      x[d] = lo[d] + (i + (mode == BINNED ? 0.5 : 0.0))/inv_step[d];
+    }
+  }
+
+  // clamped cell index, branch-free (fmin/fmax compile to min/max instructions)
+
+  long cell_index(int d, double x) const {
+    double t = (x - lo[d])*inv_step[d];
+    t = fmax(0.0, fmin(t, n[d] - 1.0));
+    return (long) t;
+  }
+
+  double eval_binned(const double* x) const {
+    long c = 0;
+    for(int d = 0; d < n_dim; d++) c = c*n[d] + cell_index(d, x[d]);
+    return table[c];
+  }
+
+  double eval_grid(const double* x) const {
+
+    long   base = 0;
+    long   stride[3];
+    double f[3];
+
+    long s = 1;
+    for(int d = n_dim - 1; d >= 0; d--) { stride[d] = s; s *= n[d]; }
+
+    for(int d = 0; d < n_dim; d++) {
+      double t = (x[d] - lo[d])*inv_step[d];
+      t = fmax(0.0, fmin(t, n[d] - 1.000001)); // keep i+1 inside the grid
+      long i = (long) t;
+      f[d] = t - i;
+      base += i*stride[d];
+    }
+
+    double val = 0.0;
+    for(int corner = 0; corner < (1 << n_dim); corner++) {
+      double w = 1.0;
+      long   k = base;
+      for(int d = 0; d < n_dim; d++) {
+	int up = (corner >> d) & 1;
+	w *= up ? f[d] : 1.0 - f[d];
+	k += up*stride[d];
+      }
+      val += w*table[k];
+    }
+    return val;
+  }
+
+};
+
+#endif
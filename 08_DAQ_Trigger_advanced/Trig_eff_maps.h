@@ -0,0 +1,243 @@
+#ifndef TRIG_EFF_MAPS_H
+#define TRIG_EFF_MAPS_H
+
+// ==============================================================================
+//
+// Compact multi-dimensional (1-3 D) counting histograms for TAG and PROBE
+// efficiency maps, with K Poisson-bootstrap replicas filled in the same pass.
+//
+// Each event gets K weights w_k ~ Poisson(1), drawn from a counter-based
+// generator keyed by (seed, event index). The same weights are used for every
+// fill of this event (both muons, TAG and PROBE), so the replicas resample
+// whole events and keep the correlation between bins and between TAG/PROBE.
+// Since the weights depend only on the event index, the result does not
+// depend on how the events are split between threads.
+//
+// Storage: one flat array of unsigned counts, cell-major, with the nominal
+// count (k = 0) followed by the K replicas: counts[cell*(K+1) + k].
+//
+// ==============================================================================
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// ==============================================================================
+
+struct EffAxis {
+
+  int    n;
+  double min;
+  double max;
+  double inv_width;
+
+  EffAxis(int n_bins = 1, double x_min = 0.0, double x_max = 1.0)
+    : n(n_bins), min(x_min), max(x_max), inv_width(n_bins/(x_max - x_min)) {}
+
+  // bin index [0,n) or -1 outside the axis range (under/overflow are dropped)
+
+  int bin(double x) const {
+    int i = (int) floor((x - min)*inv_width);
+    return (i >= 0 && i < n) ? i : -1;
+  }
+
+  double center(int i) const { return min + (i + 0.5)/inv_width; }
+
+};
+
+// ==============================================================================
+
+// Poisson(1) bootstrap weights from a counter-based (splitmix64) generator
+
+const int N_POISSON_MAX = 12; // P(w > 12) ~ 1e-10
+
+inline uint64_t splitmix64(uint64_t x) {
+
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30))*0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27))*0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+struct Poisson1CDF {
+
+  double cdf[N_POISSON_MAX];
+
+  Poisson1CDF() {
+    double term = exp(-1.0), sum = 0.0;
+    for(int j = 0; j < N_POISSON_MAX; j++) {
+      sum += term;
+      cdf[j] = sum;
+      term /= (j + 1);
+    }
+  }
+
+};
+
+inline const double* poisson1_cdf() {
+
+  static const Poisson1CDF table; // thread-safe initialisation
+  return table.cdf;
+}
+
+// w[0..K-1] for event i_evt; two 32-bit uniforms per generator call and a
+// branch-free inverse CDF: w = #{j : u > cdf[j]}
+
+inline void poisson_weights(uint64_t seed, uint64_t i_evt, int K, uint8_t* w) {
+
+  const double *cdf = poisson1_cdf();
+
+  uint64_t key  = splitmix64(seed ^ splitmix64(i_evt));
+  uint64_t bits = 0;
+
+  for(int k = 0; k < K; k++) {
+    if((k & 1) == 0) {
+      bits = splitmix64(key + (k >> 1));
+    } else {
+      bits >>= 32;
+    }
+    double u = (uint32_t) bits*(1.0/4294967296.0); // [0,1)
+    int n = 0;
+    for(int j = 0; j < N_POISSON_MAX; j++) n += (u > cdf[j]);
+    w[k] = (uint8_t) n;
+  }
+}
+
+// ==============================================================================
+
+class BootMap {
+
+public:
+
+  BootMap() : K(0), n_cells(0) {}
+
+  BootMap(const std::vector<EffAxis>& axes, int n_boot)
+    : ax(axes), K(n_boot) {
+    n_cells = 1;
+    for(size_t i = 0; i < ax.size(); i++) n_cells *= ax[i].n;
+    counts.assign((size_t) n_cells*(K + 1), 0);
+  }
+
+  int n_dim()   const { return ax.size(); }
+  int n_boot()  const { return K; }
+  int n_cell()  const { return n_cells; }
+
+  const EffAxis& axis(int i) const { return ax[i]; }
+
+  // flat cell index (last axis fastest) or -1 if any coordinate is outside
+
+  int cell(const double* x) const {
+    int c = 0;
+    for(size_t i = 0; i < ax.size(); i++) {
+      int b = ax[i].bin(x[i]);
+      if(b < 0) return -1;
+      c = c*ax[i].n + b;
+    }
+    return c;
+  }
+
+  void fill(int c, const uint8_t* w) {
+    if(c < 0) return;
+    uint32_t *cnt = &counts[(size_t) c*(K + 1)];
+    cnt[0] += 1;
+    for(int k = 0; k < K; k++) cnt[k + 1] += w[k];
+  }
+
+  void fill(const double* x, const uint8_t* w) { fill(cell(x), w); }
+
+  // k = 0 nominal, k = 1..K replicas
+
+  uint32_t count(int c, int k = 0) const { return counts[(size_t) c*(K + 1) + k]; }
+
+  void add(const BootMap& other) {
+    for(size_t i = 0; i < counts.size(); i++) counts[i] += other.counts[i];
+  }
+
+  void reset() { counts.assign(counts.size(), 0); }
+
+  // sum over all axes except i_axis: 1-D map with the same replicas
+
+  BootMap project(int i_axis) const {
+
+    BootMap proj(std::vector<EffAxis>(1, ax[i_axis]), K);
+
+    int stride = 1;
+    for(size_t i = i_axis + 1; i < ax.size(); i++) stride *= ax[i].n;
+
+    for(int c = 0; c < n_cells; c++) {
+      int b = (c/stride) % ax[i_axis].n;
+      for(int k = 0; k <= K; k++) proj.counts[(size_t) b*(K + 1) + k] += count(c, k);
+    }
+    return proj;
+  }
+
+private:
+
+  std::vector<EffAxis>  ax;
+  int                   K;
+  int                   n_cells;
+  std::vector<uint32_t> counts;
+
+};
+
+// ==============================================================================
+
+// TAG and PROBE maps of the same binning; efficiency = PROBE/TAG per cell,
+// uncertainties and bin-to-bin covariances from the spread of the replicas
+
+class EffMap {
+
+public:
+
+  BootMap tag;
+  BootMap probe;
+
+  EffMap() {}
+
+  EffMap(const std::vector<EffAxis>& axes, int n_boot)
+    : tag(axes, n_boot), probe(axes, n_boot) {}
+
+  void add(const EffMap& other) { tag.add(other.tag); probe.add(other.probe); }
+
+  EffMap project(int i_axis) const {
+    EffMap proj;
+    proj.tag   = tag.project(i_axis);
+    proj.probe = probe.project(i_axis);
+    return proj;
+  }
+
+  // efficiency of cell c in replica k (k = 0 nominal), -1 if no TAG entries
+
+  double eff(int c, int k = 0) const {
+    uint32_t n_tag = tag.count(c, k);
+    return (n_tag > 0) ? (double) probe.count(c, k)/n_tag : -1.0;
+  }
+
+  double error(int c) const { return sqrt(covariance(c, c)); }
+
+  // covariance of the efficiencies of cells c1 and c2 over the K replicas
+  // (replicas with an empty TAG cell in c1 or c2 are skipped)
+
+  double covariance(int c1, int c2) const {
+
+    int K = tag.n_boot();
+    double s1 = 0.0, s2 = 0.0, s12 = 0.0;
+    int n = 0;
+
+    for(int k = 1; k <= K; k++) {
+      double e1 = eff(c1, k);
+      double e2 = eff(c2, k);
+      if(e1 < 0.0 || e2 < 0.0) continue;
+      s1  += e1;
+      s2  += e2;
+      s12 += e1*e2;
+      n++;
+    }
+    if(n < 2) return 0.0;
+
+    return (s12 - s1*s2/n)/(n - 1);
+  }
+
+};
+
+#endif
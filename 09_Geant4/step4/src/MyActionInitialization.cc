@@ -1,11 +1,20 @@
 #include "MyActionInitialization.h"
 #include "MyPrimaryGenerator.h"
+#include "MyRunAction.h"
 
 
 MyActionInitialization::MyActionInitialization() { }
 
+// In multithreaded mode only the run action exists on the master, where the
+// runs of the workers are merged
+void MyActionInitialization::BuildForMaster() const
+{
+  SetUserAction(new MyRunAction());
+}
+
 void MyActionInitialization::Build() const
 {
   MyPrimaryGenerator *generator = new MyPrimaryGenerator();
   SetUserAction(generator);
+  SetUserAction(new MyRunAction());
 }
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <cstdlib>
 #include "G4RunManager.hh"
+#include "G4RunManagerFactory.hh"
+#include "G4Threading.hh"
 #include "G4UImanager.hh"
 #include "G4VisManager.hh"
 #include "G4VisExecutive.hh"
@@ -14,7 +17,25 @@
 
 int main(int argc, char **argv)
 {
-  G4RunManager *runManager = new G4RunManager();
+  // exercise [-t N] [-n N] [macro]
+  //  -t N: number of worker threads (default: all cores). The run manager is
+  //        the tasking one of a multithreaded Geant4 build, G4RUN_MANAGER_TYPE=Serial
+  //        or MT in the environment selects another.
+  //  -n N, macro: batch mode, without visualization, executes the macro and/or
+  //        runs N events. Without both, the interactive session is started.
+  G4int nThreads = G4Threading::G4GetNumberOfCores();
+  G4int nEvents = 0;
+  G4String macro;
+  for (G4int i=1; i<argc; i++) {
+    G4String arg = argv[i];
+    if (arg == "-t" && i+1 < argc) nThreads = atoi(argv[++i]);
+    else if (arg == "-n" && i+1 < argc) nEvents = atoi(argv[++i]);
+    else if (arg[0] != '-') macro = arg;
+  }
+  G4bool batch = nEvents > 0 || !macro.empty();
+
+  G4RunManager *runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::Default);
+  runManager->SetNumberOfThreads(nThreads);
   runManager->SetUserInitialization(new MyDetectorConstruction());
 
   G4PhysListFactory physListFactory;
@@ -26,6 +47,16 @@ int main(int argc, char **argv)
   runManager->SetUserInitialization(new MyActionInitialization());
   runManager->Initialize();
 
+  if (batch) {
+    // no trajectories are stored without visualization
+    G4UImanager *UImanager = G4UImanager::GetUIpointer();
+    UImanager->ApplyCommand("/tracking/storeTrajectory 0");
+    if (!macro.empty()) UImanager->ApplyCommand("/control/execute " + macro);
+    if (nEvents > 0) runManager->BeamOn(nEvents);
+    delete runManager;
+    return 0;
+  }
+
   G4UIExecutive *ui = new G4UIExecutive(argc,argv);
 
   G4VisManager *visManager = new G4VisExecutive();
@@ -2,6 +2,7 @@
 #define MYDETECTORCONSTRUCTION_H
 
 #include "G4VUserDetectorConstruction.hh"
+#include "globals.hh"
 
 class G4VPhysicalVolume;
 class G4LogicalVolume;
@@ -10,7 +11,7 @@ class MyDetectorConstruction : public G4VUserDetectorConstruction
 {
 public: 
 
-  MyDetectorConstruction();
+  MyDetectorConstruction(G4int ndiv = 10);
 
   ~MyDetectorConstruction();
 
@@ -18,6 +19,7 @@ public:
 
 private:
   G4LogicalVolume * logicDet;
+  G4int fNdiv;
 //  virtual void ConstructSDandField();
      
 };
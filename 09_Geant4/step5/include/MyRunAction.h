@@ -0,0 +1,20 @@
+#ifndef MyRunAction_H
+#define MyRunAction_H
+
+#include "G4UserRunAction.hh"
+#include "G4Timer.hh"
+
+class G4Run;
+
+class MyRunAction : public G4UserRunAction
+{
+public:
+  MyRunAction();
+  ~MyRunAction();
+  virtual void BeginOfRunAction(const G4Run *);
+  virtual void EndOfRunAction(const G4Run *);
+private:
+  G4Timer fTimer;
+};
+
+#endif
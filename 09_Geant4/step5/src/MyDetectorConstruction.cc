@@ -7,11 +7,12 @@
 #include "G4Box.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
+#include "G4PVReplica.hh"
 #include "G4ThreeVector.hh"
 #include "G4MaterialPropertiesTable.hh"
 //#include "MySensitiveDetector.h"
 
-MyDetectorConstruction::MyDetectorConstruction() { }
+MyDetectorConstruction::MyDetectorConstruction(G4int ndiv) : fNdiv(ndiv) { }
 
 MyDetectorConstruction::~MyDetectorConstruction() { }
 
@@ -54,15 +55,21 @@ G4VPhysicalVolume *MyDetectorConstruction::Construct() {
   G4LogicalVolume *logicPlate = new G4LogicalVolume(solidPlate, Pb, "logicPlate");
   G4VPhysicalVolume *physPlate= new G4PVPlacement(0, G4ThreeVector(0.,0.,0.25*m), logicPlate, "physPlate", logicWorld, false, 0, true);
   
-  int ndiv=10;
+  // ndiv x ndiv pads: the plane is replicated in ndiv rows along x, each row
+  // in ndiv pads along y. Pad (i, j) is at (-0.5m+(i+0.5)m/ndiv, -0.5m+(j+0.5)m/ndiv)
+  // and has replica numbers j (pad) and i (row), copy number j+i*ndiv.
+  G4int ndiv = fNdiv;
+  G4Box *solidPlane = new G4Box("solidPlane", 0.5*m, 0.5*m, 0.01*m);
+  G4LogicalVolume *logicPlane = new G4LogicalVolume(solidPlane, worldMat, "logicPlane");
+  G4VPhysicalVolume *physPlane = new G4PVPlacement(0, G4ThreeVector(0., 0., 0.4*m), logicPlane, "physPlane", logicWorld, false, 0, true);
+
+  G4Box *solidRow = new G4Box("solidRow", 0.5/ndiv*m, 0.5*m, 0.01*m);
+  G4LogicalVolume *logicRow = new G4LogicalVolume(solidRow, worldMat, "logicRow");
+  new G4PVReplica("physRow", logicRow, logicPlane, kXAxis, ndiv, 1.*m/ndiv);
+
   G4Box *solidDet = new G4Box("solidDet",0.5/ndiv*m, 0.5/ndiv*m, 0.01*m);
   logicDet = new G4LogicalVolume(solidDet, worldMat, "logicDetector");
-  
-  for (G4int i=0; i<ndiv; i++) {
-    for (G4int j=0; j<ndiv; j++) {
-      G4VPhysicalVolume *physDet = new G4PVPlacement(0,G4ThreeVector(-0.5*m+(i+0.5)*m/ndiv, -0.5*m+(j+0.5)*m/ndiv, 0.4*m),logicDet, "physDet",logicWorld, false, j+i*ndiv, true); 
-    }
-  }   
+  new G4PVReplica("physDet", logicDet, logicRow, kYAxis, ndiv, 1.*m/ndiv);
    
   return physWorld;
 }
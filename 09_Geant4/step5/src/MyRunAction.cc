@@ -0,0 +1,20 @@
+#include "MyRunAction.h"
+
+#include "G4Run.hh"
+
+MyRunAction::MyRunAction() { }
+
+MyRunAction::~MyRunAction() { }
+
+void MyRunAction::BeginOfRunAction(const G4Run *) {
+  if (IsMaster()) fTimer.Start();
+}
+
+void MyRunAction::EndOfRunAction(const G4Run *run) {
+  // the master run holds the events of all worker threads
+  if (!IsMaster()) return;
+  fTimer.Stop();
+  G4double time = fTimer.GetRealElapsed();
+  G4cout << "Run " << run->GetRunID() << ": " << run->GetNumberOfEvent() << " events in " << time << " s, "
+         << (time > 0 ? run->GetNumberOfEvent() / time : 0) << " events/s" << G4endl;
+}
@@ -7,6 +7,7 @@ class MyActionInitialization : public G4VUserActionInitialization
 {
 public:
   MyActionInitialization();
+  virtual void BuildForMaster() const;
   virtual void Build() const;
 };
 
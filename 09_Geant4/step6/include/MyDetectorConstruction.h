@@ -2,22 +2,35 @@
 #define MYDETECTORCONSTRUCTION_H
 
 #include "G4VUserDetectorConstruction.hh"
+#include "globals.hh"
 
 class G4VPhysicalVolume;
 class G4LogicalVolume;
+class G4GenericMessenger;
+class MyReadoutSegmentation;
 
 class MyDetectorConstruction : public G4VUserDetectorConstruction 
 {
 public: 
 
-  MyDetectorConstruction();
+  // virtualReadout: a single sensitive plane, pads computed from the hit
+  // position (MyReadoutSegmentation), instead of ndiv x ndiv pad volumes
+  MyDetectorConstruction(G4int ndiv = 10, G4bool virtualReadout = false);
 
   ~MyDetectorConstruction();
 
   virtual G4VPhysicalVolume *Construct();
 
+  void SetPitch(G4double pitch);
+  void SetPitchX(G4double pitch);
+  void SetPitchY(G4double pitch);
+  void SetStagger(G4double stagger);
+
 private:
   G4LogicalVolume * logicDet;
+  G4int fNdiv;
+  MyReadoutSegmentation *fSegmentation;
+  G4GenericMessenger *fMessenger;
   virtual void ConstructSDandField();
      
 };
@@ -0,0 +1,20 @@
+#ifndef MyEventAction_H
+#define MyEventAction_H
+
+#include "G4UserEventAction.hh"
+
+class G4Event;
+class MyRunAction;
+
+class MyEventAction : public G4UserEventAction
+{
+public:
+  MyEventAction(MyRunAction *);
+  ~MyEventAction();
+  virtual void EndOfEventAction(const G4Event *);
+private:
+  MyRunAction *fRunAction;
+  G4int fHCID;
+};
+
+#endif
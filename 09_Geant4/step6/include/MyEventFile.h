@@ -0,0 +1,42 @@
+#ifndef MyEventFile_H
+#define MyEventFile_H
+
+#include "globals.hh"
+#include <vector>
+
+// Primary particle, momentum in MeV, vertex in mm and ns
+struct MyPrimaryData
+{
+  G4int pdg;
+  G4float px, py, pz;
+  G4float x, y, z, t;
+};
+
+// Binary file of primary events, e.g. converted from the output of a
+// physics generator:
+//
+//   "PRIMEVT1"
+//   per event: G4int nParticles, nParticles x MyPrimaryData (32 bytes)
+//
+// in the byte order of the machine. The file is memory mapped once and
+// shared by all threads, which read their events directly from the mapping.
+class MyEventFile
+{
+public:
+  // mapped file, 0 if it cannot be read
+  static const MyEventFile *Open(const G4String &fileName);
+
+  size_t GetNEvents() const { return fOffsets.size(); }
+  const MyPrimaryData *GetEvent(size_t i, G4int &nParticles) const;
+
+private:
+  MyEventFile();
+  ~MyEventFile();
+  G4bool Map(const G4String &fileName);
+
+  const char *fData;
+  size_t fSize;
+  std::vector<size_t> fOffsets;   // of the particle count of each event
+};
+
+#endif
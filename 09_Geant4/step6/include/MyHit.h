@@ -0,0 +1,45 @@
+#ifndef MyHit_H
+#define MyHit_H
+
+#include "G4VHit.hh"
+#include "G4THitsCollection.hh"
+#include "G4Allocator.hh"
+
+// Hit of one pad in one event, written as it is to the output file
+// (MyHitWriter.h): the earliest track entering the pad gives the time and
+// position, the energy deposits of all of them are summed
+struct MyHitData
+{
+  G4int copyNo;
+  G4int nTracks;
+  G4float time;      // ns
+  G4float edep;      // MeV
+  G4float x, y, z;   // mm
+};
+
+class MyHit : public G4VHit
+{
+public:
+  MyHit() { }
+  ~MyHit() { }
+
+  inline void *operator new(size_t);
+  inline void operator delete(void *);
+
+  MyHitData data;
+};
+
+typedef G4THitsCollection<MyHit> MyHitsCollection;
+
+extern G4ThreadLocal G4Allocator<MyHit> *MyHitAllocator;
+
+inline void *MyHit::operator new(size_t) {
+  if (!MyHitAllocator) MyHitAllocator = new G4Allocator<MyHit>;
+  return (void *) MyHitAllocator->MallocSingle();
+}
+
+inline void MyHit::operator delete(void *hit) {
+  MyHitAllocator->FreeSingle((MyHit *) hit);
+}
+
+#endif
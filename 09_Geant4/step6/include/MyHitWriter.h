@@ -0,0 +1,38 @@
+#ifndef MyHitWriter_H
+#define MyHitWriter_H
+
+#include "globals.hh"
+#include "MyHit.h"
+#include <cstdio>
+#include <vector>
+
+// Buffered binary output of the pad hits, one file per thread:
+//
+//   "PADHITS1"
+//   per event: G4int eventID, G4int nHits, nHits x MyHitData (28 bytes)
+//
+// in the byte order of the machine. With compression (and zlib found by
+// CMake) the file is written through gzip.
+class MyHitWriter
+{
+public:
+  MyHitWriter();
+  ~MyHitWriter();
+
+  G4bool Open(const G4String &fileName, G4bool compress);
+  void Write(G4int eventID, const MyHitsCollection *hits);
+  void Close();
+  G4bool IsOpen() const { return fFile || fGzFile; }
+
+private:
+  void Append(const void *data, size_t size);
+  void Flush();
+
+  FILE *fFile;
+  void *fGzFile;
+  std::vector<char> fBuffer;
+  size_t fUsed;
+  G4bool fError;
+};
+
+#endif
@@ -2,19 +2,56 @@
 #define MyPrimaryGenerator_H
 
 #include "G4VUserPrimaryGeneratorAction.hh"
+#include "MyEventFile.h"
+#include <map>
+#include <vector>
 
 class G4Event;
-class  G4ParticleGun;
+class G4ParticleDefinition;
+class G4GenericMessenger;
+namespace CLHEP { class RandGauss; }
 
+// Primaries of an event, in this order of precedence:
+//  - from the events of a file (/exercise/gun/file), event i of the run
+//    takes event i modulo the number of events of the file
+//  - from a pool of /exercise/gun/pool N primaries sampled once per thread
+//    from its own engine seeded with /exercise/gun/poolSeed, so that all
+//    threads hold the same pool whatever event they start with
+//  - sampled for each event
+// Sampled primaries: /exercise/gun/particle along +z with /exercise/gun/momentum,
+// gaussian relative momentum spread and gaussian x, y vertex spread
+// (default: 10 GeV e- from the origin).
 class MyPrimaryGenerator : public G4VUserPrimaryGeneratorAction 
 {
 public:
   MyPrimaryGenerator();
   ~MyPrimaryGenerator();
   virtual void GeneratePrimaries( G4Event *ev) ;
+
+  void SetEventFile(G4String fileName);
+  void SetParticle(G4String name);
+  void SetMomentum(G4double momentum);
+  void SetMomentumSpread(G4double spread);
+  void SetVertexSpread(G4double sigma);
+  void SetPoolSize(G4int n);
+  void SetPoolSeed(G4int seed);
+
 private:
-  G4ParticleGun *fParticleGun;
+  void Sample(MyPrimaryData &primary, CLHEP::RandGauss *gauss) const;
+  G4ParticleDefinition *Definition(G4int pdg);
+
+  const MyEventFile *fEventFile;
+  std::vector<MyPrimaryData> fPool;
+  G4int fPoolSize;
+  G4int fPoolSeed;
+
+  G4int fPdg;
+  G4double fMomentum;
+  G4double fMomentumSpread;
+  G4double fVertexSpread;
+
+  std::map<G4int, G4ParticleDefinition *> fDefinitions;
+  G4GenericMessenger *fMessenger;
 };
 
 #endif 
-
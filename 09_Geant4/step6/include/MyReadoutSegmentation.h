@@ -0,0 +1,35 @@
+#ifndef MyReadoutSegmentation_H
+#define MyReadoutSegmentation_H
+
+#include "globals.hh"
+
+// Pads of a detector plane computed from the hit position, without volumes
+// for the pads. The plane, centred at (x0, y0) with full sizes sizeX x sizeY,
+// is divided in rows of width pitchX along x, each row in pads of pitchY
+// along y; odd rows are shifted along y by stagger * pitchY (0: square
+// layout, 0.5: brick layout). Pad j of row i has the copy number j + i*ny,
+// as the replicated pads of MyDetectorConstruction. The parts of the plane
+// not covered by a complete row or pad are not read out.
+class MyReadoutSegmentation
+{
+public:
+  MyReadoutSegmentation(G4double x0, G4double y0, G4double sizeX, G4double sizeY);
+
+  void SetPitch(G4double pitchX, G4double pitchY);
+  void SetStagger(G4double stagger) { fStagger = stagger; }
+
+  // copy number of the pad at (x, y), -1 outside the pads
+  G4int GetPad(G4double x, G4double y) const;
+
+  G4int GetNx() const { return fNx; }
+  G4int GetNy() const { return fNy; }
+  G4double GetPitchX() const { return fPitchX; }
+  G4double GetPitchY() const { return fPitchY; }
+
+private:
+  G4double fXmin, fYmin, fSizeX, fSizeY;
+  G4double fPitchX, fPitchY, fStagger;
+  G4int fNx, fNy;
+};
+
+#endif
@@ -0,0 +1,28 @@
+#ifndef MyRun_H
+#define MyRun_H
+
+#include "G4Run.hh"
+#include <map>
+
+class G4Event;
+
+// Number of hits per pad (copy number), summed over the runs of the worker
+// threads on the master
+class MyRun : public G4Run
+{
+public:
+  MyRun();
+  ~MyRun();
+  virtual void RecordEvent(const G4Event *);
+  virtual void Merge(const G4Run *);
+
+  void AddPadHit(G4int copyNo, G4int n = 1) { fPadHits[copyNo] += n; }
+  const std::map<G4int, G4int> &GetPadHits() const { return fPadHits; }
+  G4int GetNHits() const;
+
+private:
+  std::map<G4int, G4int> fPadHits;
+  G4int fHCID;
+};
+
+#endif
@@ -0,0 +1,31 @@
+#ifndef MyRunAction_H
+#define MyRunAction_H
+
+#include "G4UserRunAction.hh"
+#include "G4Timer.hh"
+#include "MyHitWriter.h"
+
+class G4Run;
+class G4GenericMessenger;
+
+class MyRunAction : public G4UserRunAction
+{
+public:
+  MyRunAction(G4bool writeHits = false);
+  ~MyRunAction();
+  virtual G4Run *GenerateRun();
+  virtual void BeginOfRunAction(const G4Run *);
+  virtual void EndOfRunAction(const G4Run *);
+
+  MyHitWriter &GetHitWriter() { return fHitWriter; }
+
+private:
+  G4Timer fTimer;
+  G4bool fWriteHits;
+  G4String fFileName;
+  G4bool fCompress;
+  MyHitWriter fHitWriter;
+  G4GenericMessenger *fMessenger;
+};
+
+#endif
@@ -1,17 +1,30 @@
-#ifndef MySensitivewDetector_H
+#ifndef MySensitiveDetector_H
 #define MySensitiveDetector_H
 
 #include "G4VSensitiveDetector.hh"
+#include "MyHit.h"
+#include <map>
 
 class G4Step;
 class G4TouchableHistory;
+class G4HCofThisEvent;
+class MyReadoutSegmentation;
 
 class MySensitiveDetector : public G4VSensitiveDetector
 {
 public:
-  MySensitiveDetector(G4String);
+  // pads from the replica numbers of the pad volumes, or from the hit
+  // position with a segmentation
+  MySensitiveDetector(G4String, G4int ndiv, const MyReadoutSegmentation *segmentation = 0);
   ~MySensitiveDetector();
+  virtual void Initialize(G4HCofThisEvent *);
 private:
   virtual G4bool ProcessHits(G4Step *, G4TouchableHistory *); 
+
+  MyHitsCollection *fHits;
+  G4int fHCID;
+  G4int fNdiv;
+  const MyReadoutSegmentation *fSegmentation;
+  std::map<G4int, size_t> fPadHit;   // copy number -> hit of this event
 };
 #endif
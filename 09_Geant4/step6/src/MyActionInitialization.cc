@@ -1,11 +1,23 @@
 #include "MyActionInitialization.h"
 #include "MyPrimaryGenerator.h"
+#include "MyRunAction.h"
+#include "MyEventAction.h"
 
 
 MyActionInitialization::MyActionInitialization() { }
 
+// In multithreaded mode only the run action exists on the master, where the
+// runs of the workers are merged
+void MyActionInitialization::BuildForMaster() const
+{
+  SetUserAction(new MyRunAction());
+}
+
 void MyActionInitialization::Build() const
 {
   MyPrimaryGenerator *generator = new MyPrimaryGenerator();
   SetUserAction(generator);
+  MyRunAction *runAction = new MyRunAction(true);
+  SetUserAction(runAction);
+  SetUserAction(new MyEventAction(runAction));
 }
@@ -7,13 +7,33 @@
 #include "G4Box.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
+#include "G4PVReplica.hh"
 #include "G4ThreeVector.hh"
 #include "G4MaterialPropertiesTable.hh"
+#include "G4SDManager.hh"
+#include "G4GenericMessenger.hh"
 #include "MySensitiveDetector.h"
+#include "MyReadoutSegmentation.h"
 
-MyDetectorConstruction::MyDetectorConstruction() { }
+MyDetectorConstruction::MyDetectorConstruction(G4int ndiv, G4bool virtualReadout) : fNdiv(ndiv), fSegmentation(0), fMessenger(0) {
+  if (!virtualReadout) return;
 
-MyDetectorConstruction::~MyDetectorConstruction() { }
+  // same pads as the replicas by default; the segmentation is read by the
+  // sensitive detectors of all threads, the commands are for the master
+  fSegmentation = new MyReadoutSegmentation(0., 0., 1.*m, 1.*m);
+  fSegmentation->SetPitch(1.*m/ndiv, 1.*m/ndiv);
+
+  fMessenger = new G4GenericMessenger(this, "/exercise/readout/", "Virtual readout segmentation");
+  fMessenger->DeclareMethodWithUnit("pitch", "mm", &MyDetectorConstruction::SetPitch, "Pad size along x and y").SetToBeBroadcasted(false);
+  fMessenger->DeclareMethodWithUnit("pitchX", "mm", &MyDetectorConstruction::SetPitchX, "Row width (along x)").SetToBeBroadcasted(false);
+  fMessenger->DeclareMethodWithUnit("pitchY", "mm", &MyDetectorConstruction::SetPitchY, "Pad size along y").SetToBeBroadcasted(false);
+  fMessenger->DeclareMethod("stagger", &MyDetectorConstruction::SetStagger, "Shift of odd rows along y, in pads (0.5: brick layout)").SetToBeBroadcasted(false);
+}
+
+MyDetectorConstruction::~MyDetectorConstruction() {
+  delete fMessenger;
+  delete fSegmentation;
+}
 
 G4VPhysicalVolume *MyDetectorConstruction::Construct() {
 
@@ -54,20 +74,56 @@ G4VPhysicalVolume *MyDetectorConstruction::Construct() {
   G4LogicalVolume *logicPlate = new G4LogicalVolume(solidPlate, Pb, "logicPlate");
   G4VPhysicalVolume *physPlate= new G4PVPlacement(0, G4ThreeVector(0.,0.,0.25*m), logicPlate, "physPlate", logicWorld, false, 0, true);
   
-  int ndiv=10;
+  if (fSegmentation) {
+    // a single sensitive plane, read out by MyReadoutSegmentation
+    G4Box *solidDet = new G4Box("solidDet", 0.5*m, 0.5*m, 0.01*m);
+    logicDet = new G4LogicalVolume(solidDet, worldMat, "logicDetector");
+    G4VPhysicalVolume *physDet = new G4PVPlacement(0, G4ThreeVector(0., 0., 0.4*m), logicDet, "physDet", logicWorld, false, 0, true);
+    return physWorld;
+  }
+
+  // ndiv x ndiv pads: the plane is replicated in ndiv rows along x, each row
+  // in ndiv pads along y. Pad (i, j) is at (-0.5m+(i+0.5)m/ndiv, -0.5m+(j+0.5)m/ndiv)
+  // and has replica numbers j (pad) and i (row), copy number j+i*ndiv.
+  G4int ndiv = fNdiv;
+  G4Box *solidPlane = new G4Box("solidPlane", 0.5*m, 0.5*m, 0.01*m);
+  G4LogicalVolume *logicPlane = new G4LogicalVolume(solidPlane, worldMat, "logicPlane");
+  G4VPhysicalVolume *physPlane = new G4PVPlacement(0, G4ThreeVector(0., 0., 0.4*m), logicPlane, "physPlane", logicWorld, false, 0, true);
+
+  G4Box *solidRow = new G4Box("solidRow", 0.5/ndiv*m, 0.5*m, 0.01*m);
+  G4LogicalVolume *logicRow = new G4LogicalVolume(solidRow, worldMat, "logicRow");
+  new G4PVReplica("physRow", logicRow, logicPlane, kXAxis, ndiv, 1.*m/ndiv);
+
   G4Box *solidDet = new G4Box("solidDet",0.5/ndiv*m, 0.5/ndiv*m, 0.01*m);
   logicDet = new G4LogicalVolume(solidDet, worldMat, "logicDetector");
-  
-  for (G4int i=0; i<ndiv; i++) {
-    for (G4int j=0; j<ndiv; j++) {
-      G4VPhysicalVolume *physDet = new G4PVPlacement(0,G4ThreeVector(-0.5*m+(i+0.5)*m/ndiv, -0.5*m+(j+0.5)*m/ndiv, 0.4*m),logicDet, "physDet",logicWorld, false, j+i*ndiv, true); 
-    }
-  }   
+  new G4PVReplica("physDet", logicDet, logicRow, kYAxis, ndiv, 1.*m/ndiv);
    
   return physWorld;
 }
 
+// Called on every worker thread (and on the master in sequential mode): each
+// thread has its own sensitive detector, the geometry is shared
 void MyDetectorConstruction::ConstructSDandField() {
-  MySensitiveDetector *sensDet = new MySensitiveDetector("SensitiveDetector");
-  logicDet->SetSensitiveDetector(sensDet);
+  MySensitiveDetector *sensDet = new MySensitiveDetector("SensitiveDetector", fNdiv, fSegmentation);
+  G4SDManager::GetSDMpointer()->AddNewDetector(sensDet);
+  SetSensitiveDetector(logicDet, sensDet);
+}
+
+void MyDetectorConstruction::SetPitch(G4double pitch) {
+  fSegmentation->SetPitch(pitch, pitch);
+  G4cout << "Readout: " << fSegmentation->GetNx() << " x " << fSegmentation->GetNy() << " pads" << G4endl;
+}
+
+void MyDetectorConstruction::SetPitchX(G4double pitch) {
+  fSegmentation->SetPitch(pitch, fSegmentation->GetPitchY());
+  G4cout << "Readout: " << fSegmentation->GetNx() << " x " << fSegmentation->GetNy() << " pads" << G4endl;
+}
+
+void MyDetectorConstruction::SetPitchY(G4double pitch) {
+  fSegmentation->SetPitch(fSegmentation->GetPitchX(), pitch);
+  G4cout << "Readout: " << fSegmentation->GetNx() << " x " << fSegmentation->GetNy() << " pads" << G4endl;
+}
+
+void MyDetectorConstruction::SetStagger(G4double stagger) {
+  fSegmentation->SetStagger(stagger);
 }
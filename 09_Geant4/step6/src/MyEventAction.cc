@@ -0,0 +1,19 @@
+#include "MyEventAction.h"
+#include "MyRunAction.h"
+#include "MyHit.h"
+
+#include "G4Event.hh"
+#include "G4HCofThisEvent.hh"
+#include "G4SDManager.hh"
+
+MyEventAction::MyEventAction(MyRunAction *runAction) : fRunAction(runAction), fHCID(-1) { }
+
+MyEventAction::~MyEventAction() { }
+
+void MyEventAction::EndOfEventAction(const G4Event *ev) {
+  G4HCofThisEvent *hce = ev->GetHCofThisEvent();
+  if (!hce) return;
+  if (fHCID < 0) fHCID = G4SDManager::GetSDMpointer()->GetCollectionID("SensitiveDetector/padHits");
+  const MyHitsCollection *hits = static_cast<const MyHitsCollection *>(hce->GetHC(fHCID));
+  fRunAction->GetHitWriter().Write(ev->GetEventID(), hits);
+}
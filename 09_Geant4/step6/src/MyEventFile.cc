@@ -0,0 +1,81 @@
+#include "MyEventFile.h"
+
+#include "G4AutoLock.hh"
+#include <cstring>
+#include <map>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+  G4Mutex eventFileMutex = G4MUTEX_INITIALIZER;
+  std::map<G4String, MyEventFile *> eventFiles;
+}
+
+// The files stay mapped until the end of the program
+const MyEventFile *MyEventFile::Open(const G4String &fileName) {
+  G4AutoLock lock(&eventFileMutex);
+  std::map<G4String, MyEventFile *>::iterator it = eventFiles.find(fileName);
+  if (it != eventFiles.end()) return it->second;
+
+  MyEventFile *file = new MyEventFile();
+  if (!file->Map(fileName)) {
+    delete file;
+    return 0;
+  }
+  G4cout << "MyEventFile: " << file->GetNEvents() << " events in " << fileName << G4endl;
+  eventFiles[fileName] = file;
+  return file;
+}
+
+MyEventFile::MyEventFile() : fData(0), fSize(0) { }
+
+MyEventFile::~MyEventFile() {
+  if (fData) munmap((void *) fData, fSize);
+}
+
+const MyPrimaryData *MyEventFile::GetEvent(size_t i, G4int &nParticles) const {
+  const char *event = fData + fOffsets[i];
+  memcpy(&nParticles, event, sizeof(G4int));
+  return (const MyPrimaryData *) (event + sizeof(G4int));
+}
+
+G4bool MyEventFile::Map(const G4String &fileName) {
+  int fd = open(fileName.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    G4cerr << "MyEventFile: cannot open " << fileName << G4endl;
+    if (fd >= 0) close(fd);
+    return false;
+  }
+  fSize = st.st_size;
+  void *data = fSize ? mmap(0, fSize, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (data == MAP_FAILED) {
+    G4cerr << "MyEventFile: cannot map " << fileName << G4endl;
+    fSize = 0;
+    return false;
+  }
+  fData = (const char *) data;
+  madvise(data, fSize, MADV_WILLNEED);
+
+  if (fSize < 8 || memcmp(fData, "PRIMEVT1", 8) != 0) {
+    G4cerr << "MyEventFile: " << fileName << " is not a primary event file" << G4endl;
+    return false;
+  }
+  // index of the events
+  size_t offset = 8;
+  while (offset + sizeof(G4int) <= fSize) {
+    G4int n;
+    memcpy(&n, fData + offset, sizeof(G4int));
+    size_t next = offset + sizeof(G4int) + (size_t) n * sizeof(MyPrimaryData);
+    if (n < 0 || next > fSize) {
+      G4cerr << "MyEventFile: " << fileName << " is truncated after " << fOffsets.size() << " events" << G4endl;
+      break;
+    }
+    fOffsets.push_back(offset);
+    offset = next;
+  }
+  return !fOffsets.empty();
+}
@@ -0,0 +1,3 @@
+#include "MyHit.h"
+
+G4ThreadLocal G4Allocator<MyHit> *MyHitAllocator = 0;
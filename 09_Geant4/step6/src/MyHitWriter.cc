@@ -0,0 +1,72 @@
+#include "MyHitWriter.h"
+
+#include <cstring>
+#ifdef EXERCISE_USE_ZLIB
+#include <zlib.h>
+#endif
+
+MyHitWriter::MyHitWriter() : fFile(0), fGzFile(0), fBuffer(1 << 20), fUsed(0), fError(false) { }
+
+MyHitWriter::~MyHitWriter() {
+  Close();
+}
+
+G4bool MyHitWriter::Open(const G4String &fileName, G4bool compress) {
+  Close();
+#ifdef EXERCISE_USE_ZLIB
+  if (compress) fGzFile = gzopen((fileName + ".gz").c_str(), "wb");
+#else
+  if (compress) G4cout << "MyHitWriter: built without zlib, " << fileName << " is not compressed" << G4endl;
+  compress = false;
+#endif
+  if (!compress) fFile = fopen(fileName.c_str(), "wb");
+  if (!IsOpen()) {
+    G4cerr << "MyHitWriter: cannot open " << fileName << G4endl;
+    return false;
+  }
+  fError = false;
+  Append("PADHITS1", 8);
+  return true;
+}
+
+void MyHitWriter::Write(G4int eventID, const MyHitsCollection *hits) {
+  if (!IsOpen()) return;
+  G4int header[2] = { eventID, hits ? (G4int) hits->entries() : 0 };
+  Append(header, sizeof(header));
+  for (G4int i = 0; i < header[1]; i++) Append(&(*hits)[i]->data, sizeof(MyHitData));
+}
+
+void MyHitWriter::Close() {
+  if (!IsOpen()) return;
+  Flush();
+  G4bool ok = true;
+#ifdef EXERCISE_USE_ZLIB
+  if (fGzFile) ok = gzclose((gzFile) fGzFile) == Z_OK;
+#endif
+  if (fFile) ok = fclose(fFile) == 0;
+  if (!ok) G4Exception("MyHitWriter::Close", "WriteError", JustWarning, "closing the hits file failed, it may be truncated");
+  fFile = 0;
+  fGzFile = 0;
+}
+
+void MyHitWriter::Append(const void *data, size_t size) {
+  if (fUsed + size > fBuffer.size()) Flush();
+  if (size > fBuffer.size()) fBuffer.resize(size);
+  memcpy(&fBuffer[fUsed], data, size);
+  fUsed += size;
+}
+
+void MyHitWriter::Flush() {
+  if (fUsed == 0) return;
+  size_t written = 0;
+#ifdef EXERCISE_USE_ZLIB
+  if (fGzFile) written = gzwrite((gzFile) fGzFile, &fBuffer[0], fUsed) == (int) fUsed ? fUsed : 0;
+#endif
+  if (fFile) written = fwrite(&fBuffer[0], 1, fUsed, fFile);
+  if (written != fUsed && !fError) {
+    // e.g. a full disk: reported once, the file is truncated
+    G4Exception("MyHitWriter::Flush", "WriteError", JustWarning, "writing the hits file failed, the file is truncated");
+    fError = true;
+  }
+  fUsed = 0;
+}
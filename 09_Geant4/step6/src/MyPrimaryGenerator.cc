@@ -1,29 +1,123 @@
 #include "MyPrimaryGenerator.h"
 #include "G4Event.hh"
-#include "G4ParticleGun.hh"
+#include "G4PrimaryVertex.hh"
+#include "G4PrimaryParticle.hh"
 #include "G4SystemOfUnits.hh"
 #include "G4ParticleTable.hh"
 #include "G4ThreeVector.hh"
 #include "G4ParticleDefinition.hh"
+#include "G4GenericMessenger.hh"
+#include "Randomize.hh"
+#include "CLHEP/Random/MixMaxRng.h"
 
-MyPrimaryGenerator::MyPrimaryGenerator() { 
-  fParticleGun = new G4ParticleGun(1);
+MyPrimaryGenerator::MyPrimaryGenerator() : fEventFile(0), fPoolSize(0), fPoolSeed(12345), fPdg(11), 
+  fMomentum(10.*GeV), fMomentumSpread(0), fVertexSpread(0) { 
+  fMessenger = new G4GenericMessenger(this, "/exercise/gun/", "Primary generator");
+  fMessenger->DeclareMethod("file", &MyPrimaryGenerator::SetEventFile, "Binary file of primary events (none if empty)");
+  fMessenger->DeclareMethod("particle", &MyPrimaryGenerator::SetParticle, "Sampled particle");
+  fMessenger->DeclareMethodWithUnit("momentum", "GeV", &MyPrimaryGenerator::SetMomentum, "Momentum of the sampled particles");
+  fMessenger->DeclareMethod("momentumSpread", &MyPrimaryGenerator::SetMomentumSpread, "Relative gaussian momentum spread");
+  fMessenger->DeclareMethodWithUnit("vertexSpread", "mm", &MyPrimaryGenerator::SetVertexSpread, "Gaussian x, y spread of the vertex");
+  fMessenger->DeclareMethod("pool", &MyPrimaryGenerator::SetPoolSize, "Number of primaries sampled in advance (0: per event)");
+  fMessenger->DeclareMethod("poolSeed", &MyPrimaryGenerator::SetPoolSeed, "Seed of the engine that samples the pool");
 }
 
 MyPrimaryGenerator::~MyPrimaryGenerator() {
-  delete fParticleGun;
+  delete fMessenger;
 }
 
 void MyPrimaryGenerator::GeneratePrimaries(G4Event *ev) {
-  G4ParticleTable * particleTable = G4ParticleTable::GetParticleTable();
-  G4String beamPart="e-";
-  G4ParticleDefinition *particle=particleTable->FindParticle(beamPart);
-  G4ThreeVector pos(0., 0., 0.);
-  G4ThreeVector mom(0.,0.,1.);
-
-  fParticleGun->SetParticlePosition(pos);
-  fParticleGun->SetParticleMomentumDirection(mom);
-  fParticleGun->SetParticleMomentum(10.*GeV);
-  fParticleGun->SetParticleDefinition(particle);
-  fParticleGun->GeneratePrimaryVertex(ev);
+  G4int n = 1;
+  const MyPrimaryData *primaries;
+  MyPrimaryData sampled;
+  if (fEventFile) {
+    primaries = fEventFile->GetEvent(ev->GetEventID() % fEventFile->GetNEvents(), n);
+  } else if (fPoolSize > 0) {
+    if (fPool.empty()) {
+      // not from the event's engine: the pool would depend on the first
+      // event of the thread and shift that event's random sequence
+      CLHEP::MixMaxRng engine(fPoolSeed);
+      CLHEP::RandGauss gauss(engine);
+      fPool.resize(fPoolSize);
+      for (G4int i=0; i<fPoolSize; i++) Sample(fPool[i], &gauss);
+    }
+    primaries = &fPool[ev->GetEventID() % fPoolSize];
+  } else {
+    Sample(sampled, 0);
+    primaries = &sampled;
+  }
+
+  // particles from the same point share their vertex
+  G4PrimaryVertex *vertex = 0;
+  for (G4int i=0; i<n; i++) {
+    const MyPrimaryData &p = primaries[i];
+    G4ThreeVector pos(p.x*mm, p.y*mm, p.z*mm);
+    if (!vertex || vertex->GetPosition() != pos || vertex->GetT0() != p.t*ns) {
+      vertex = new G4PrimaryVertex(pos, p.t*ns);
+      ev->AddPrimaryVertex(vertex);
+    }
+    vertex->SetPrimary(new G4PrimaryParticle(Definition(p.pdg), p.px*MeV, p.py*MeV, p.pz*MeV));
+  }
+}
+
+// from gauss if given, else from the engine of the thread
+void MyPrimaryGenerator::Sample(MyPrimaryData &primary, CLHEP::RandGauss *gauss) const {
+  auto gaussian = [gauss]() { return gauss ? gauss->fire() : G4RandGauss::shoot(); };
+  primary.pdg = fPdg;
+  primary.px = 0;
+  primary.py = 0;
+  primary.pz = fMomentum*(1 + fMomentumSpread*gaussian())/MeV;
+  primary.x = fVertexSpread > 0 ? fVertexSpread*gaussian()/mm : 0;
+  primary.y = fVertexSpread > 0 ? fVertexSpread*gaussian()/mm : 0;
+  primary.z = 0;
+  primary.t = 0;
+}
+
+G4ParticleDefinition *MyPrimaryGenerator::Definition(G4int pdg) {
+  std::map<G4int, G4ParticleDefinition *>::iterator it = fDefinitions.find(pdg);
+  if (it != fDefinitions.end()) return it->second;
+  G4ParticleDefinition *particle = G4ParticleTable::GetParticleTable()->FindParticle(pdg);
+  if (!particle) G4Exception("MyPrimaryGenerator", "UnknownParticle", FatalException, "unknown PDG code of a primary");
+  fDefinitions[pdg] = particle;
+  return particle;
+}
+
+void MyPrimaryGenerator::SetEventFile(G4String fileName) {
+  fEventFile = fileName.empty() ? 0 : MyEventFile::Open(fileName);
+}
+
+void MyPrimaryGenerator::SetParticle(G4String name) {
+  G4ParticleDefinition *particle = G4ParticleTable::GetParticleTable()->FindParticle(name);
+  if (!particle) {
+    G4cerr << "MyPrimaryGenerator: unknown particle " << name << G4endl;
+    return;
+  }
+  fPdg = particle->GetPDGEncoding();
+  fDefinitions[fPdg] = particle;
+  fPool.clear();
+}
+
+void MyPrimaryGenerator::SetMomentum(G4double momentum) {
+  fMomentum = momentum;
+  fPool.clear();
+}
+
+void MyPrimaryGenerator::SetMomentumSpread(G4double spread) {
+  fMomentumSpread = spread;
+  fPool.clear();
+}
+
+void MyPrimaryGenerator::SetVertexSpread(G4double sigma) {
+  fVertexSpread = sigma;
+  fPool.clear();
+}
+
+void MyPrimaryGenerator::SetPoolSize(G4int n) {
+  fPoolSize = n > 0 ? n : 0;
+  fPool.clear();
+}
+
+void MyPrimaryGenerator::SetPoolSeed(G4int seed) {
+  fPoolSeed = seed;
+  fPool.clear();
 }
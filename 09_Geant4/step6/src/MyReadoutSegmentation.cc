@@ -0,0 +1,26 @@
+#include "MyReadoutSegmentation.h"
+
+#include <cmath>
+
+MyReadoutSegmentation::MyReadoutSegmentation(G4double x0, G4double y0, G4double sizeX, G4double sizeY) :
+  fXmin(x0 - 0.5*sizeX), fYmin(y0 - 0.5*sizeY), fSizeX(sizeX), fSizeY(sizeY), fPitchX(sizeX), fPitchY(sizeY), fStagger(0), fNx(1), fNy(1)
+{ }
+
+void MyReadoutSegmentation::SetPitch(G4double pitchX, G4double pitchY) {
+  if (pitchX <= 0 || pitchY <= 0) return;
+  fPitchX = pitchX;
+  fPitchY = pitchY;
+  // rounded, so that pitches of sizes/ndiv give ndiv pads
+  fNx = (G4int) std::floor(fSizeX/pitchX + 1e-9);
+  fNy = (G4int) std::floor(fSizeY/pitchY + 1e-9);
+}
+
+G4int MyReadoutSegmentation::GetPad(G4double x, G4double y) const {
+  G4double u = (x - fXmin)/fPitchX;
+  if (!(u >= 0 && u < fNx)) return -1;
+  G4int i = (G4int) u;
+  G4double v = (y - fYmin)/fPitchY - ((i & 1) ? fStagger : 0);
+  if (!(v >= 0 && v < fNy)) return -1;
+  G4int j = (G4int) v;
+  return j + i*fNy;
+}
@@ -0,0 +1,33 @@
+#include "MyRun.h"
+#include "MyHit.h"
+
+#include "G4Event.hh"
+#include "G4HCofThisEvent.hh"
+#include "G4SDManager.hh"
+
+MyRun::MyRun() : fHCID(-1) { }
+
+MyRun::~MyRun() { }
+
+void MyRun::RecordEvent(const G4Event *ev) {
+  G4HCofThisEvent *hce = ev->GetHCofThisEvent();
+  if (hce) {
+    if (fHCID < 0) fHCID = G4SDManager::GetSDMpointer()->GetCollectionID("SensitiveDetector/padHits");
+    const MyHitsCollection *hits = static_cast<const MyHitsCollection *>(hce->GetHC(fHCID));
+    for (size_t i = 0; hits && i < hits->entries(); i++) AddPadHit((*hits)[i]->data.copyNo, (*hits)[i]->data.nTracks);
+  }
+  G4Run::RecordEvent(ev);
+}
+
+void MyRun::Merge(const G4Run *run) {
+  const MyRun *workerRun = static_cast<const MyRun *>(run);
+  for (std::map<G4int, G4int>::const_iterator it = workerRun->fPadHits.begin(); it != workerRun->fPadHits.end(); ++it)
+    fPadHits[it->first] += it->second;
+  G4Run::Merge(run);
+}
+
+G4int MyRun::GetNHits() const {
+  G4int n = 0;
+  for (std::map<G4int, G4int>::const_iterator it = fPadHits.begin(); it != fPadHits.end(); ++it) n += it->second;
+  return n;
+}
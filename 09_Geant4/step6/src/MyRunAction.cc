@@ -0,0 +1,52 @@
+#include "MyRunAction.h"
+#include "MyRun.h"
+
+#include "G4GenericMessenger.hh"
+#include "G4Threading.hh"
+#include <sstream>
+
+// The run actions of the threads processing events (the workers, or the only
+// one in sequential mode) write the hits of their events
+MyRunAction::MyRunAction(G4bool writeHits) : fWriteHits(writeHits), fFileName("hits"), fCompress(false) {
+  fMessenger = new G4GenericMessenger(this, "/exercise/output/", "Output of the pad hits");
+  fMessenger->DeclareProperty("fileName", fFileName, "Hits file name: <name>_run<N>[_t<thread>].dat, none if empty");
+  fMessenger->DeclareProperty("compress", fCompress, "Write the hits file through gzip");
+}
+
+MyRunAction::~MyRunAction() {
+  delete fMessenger;
+}
+
+G4Run *MyRunAction::GenerateRun() {
+  return new MyRun();
+}
+
+void MyRunAction::BeginOfRunAction(const G4Run *run) {
+  if (IsMaster()) fTimer.Start();
+  if (fWriteHits && !fFileName.empty()) {
+    std::ostringstream name;
+    name << fFileName << "_run" << run->GetRunID();
+    if (G4Threading::G4GetThreadId() >= 0) name << "_t" << G4Threading::G4GetThreadId();
+    name << ".dat";
+    fHitWriter.Open(name.str(), fCompress);
+  }
+}
+
+void MyRunAction::EndOfRunAction(const G4Run *aRun) {
+  fHitWriter.Close();
+  // the master run holds the merged runs of all worker threads
+  if (!IsMaster()) return;
+  fTimer.Stop();
+  const MyRun *run = static_cast<const MyRun *>(aRun);
+  G4double time = fTimer.GetRealElapsed();
+  G4cout << "Run " << run->GetRunID() << ": " << run->GetNumberOfEvent() << " events, "
+         << run->GetNHits() << " hits in " << run->GetPadHits().size() << " pads" << G4endl;
+  G4cout << "Run " << run->GetRunID() << ": " << time << " s, "
+         << (time > 0 ? run->GetNumberOfEvent() / time : 0) << " events/s" << G4endl;
+
+  G4int maxPad = -1, maxHits = 0;
+  for (std::map<G4int, G4int>::const_iterator it = run->GetPadHits().begin(); it != run->GetPadHits().end(); ++it) {
+    if (it->second > maxHits) { maxPad = it->first; maxHits = it->second; }
+  }
+  if (maxPad >= 0) G4cout << "Most hits: " << maxHits << " in pad " << maxPad << G4endl;
+}
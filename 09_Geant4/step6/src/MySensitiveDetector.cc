@@ -2,28 +2,65 @@
 
 #include "G4Step.hh"
 #include "G4TouchableHistory.hh"
+#include "G4HCofThisEvent.hh"
+#include "G4SDManager.hh"
+#include "G4SystemOfUnits.hh"
+#include "MyReadoutSegmentation.h"
 
-MySensitiveDetector::MySensitiveDetector(G4String name) : G4VSensitiveDetector(name) 
-{ }
+MySensitiveDetector::MySensitiveDetector(G4String name, G4int ndiv, const MyReadoutSegmentation *segmentation) :
+  G4VSensitiveDetector(name), fHits(0), fHCID(-1), fNdiv(ndiv), fSegmentation(segmentation)
+{
+  collectionName.insert("padHits");
+}
 
 MySensitiveDetector::~MySensitiveDetector()
 {}
 
+void MySensitiveDetector::Initialize(G4HCofThisEvent *hce) {
+  fHits = new MyHitsCollection(SensitiveDetectorName, collectionName[0]);
+  if (fHCID < 0) fHCID = G4SDManager::GetSDMpointer()->GetCollectionID(fHits);
+  hce->AddHitsCollection(fHCID, fHits);
+  fPadHit.clear();
+}
 
 G4bool MySensitiveDetector::ProcessHits(G4Step *aStep, G4TouchableHistory *ROhist){
   G4Track *track = aStep->GetTrack();
   track->SetTrackStatus(fStopAndKill);
   G4StepPoint *preStepPoint = aStep->GetPreStepPoint(); 
-  G4StepPoint *postStepPoint = aStep->GetPostStepPoint(); 
 
   G4ThreeVector position = preStepPoint->GetPosition();
-//  G4cout << "secondary position: "<<position<< G4endl;
-  const G4VTouchable *touchable = aStep->GetPreStepPoint()->GetTouchable();
-  G4int copuNo = touchable->GetCopyNumber();
-  G4VPhysicalVolume *physVol = touchable->GetVolume();  
-  G4ThreeVector posDetector = physVol->GetTranslation();
-  G4cout << "Det number :"<<copuNo<<" and position: "<<posDetector << G4endl;
+  G4int copyNo;
+  if (fSegmentation) {
+    copyNo = fSegmentation->GetPad(position.x(), position.y());
+    if (copyNo < 0) return false;
+  } else {
+    // pad j of row i (MyDetectorConstruction)
+    const G4VTouchable *touchable = preStepPoint->GetTouchable();
+    copyNo = touchable->GetCopyNumber(0) + touchable->GetCopyNumber(1)*fNdiv;
+  }
+  G4double time = preStepPoint->GetGlobalTime()/ns;
+  G4double edep = aStep->GetTotalEnergyDeposit()/MeV;
+
+  std::map<G4int, size_t>::iterator it = fPadHit.find(copyNo);
+  if (it == fPadHit.end()) {
+    MyHit *hit = new MyHit();
+    hit->data.copyNo = copyNo;
+    hit->data.nTracks = 0;
+    hit->data.time = time;
+    hit->data.edep = 0;
+    fPadHit[copyNo] = fHits->insert(hit) - 1;
+    it = fPadHit.find(copyNo);
+  }
+
+  MyHitData &data = (*fHits)[it->second]->data;
+  if (data.nTracks == 0 || time < data.time) {
+    data.time = time;
+    data.x = position.x()/mm;
+    data.y = position.y()/mm;
+    data.z = position.z()/mm;
+  }
+  data.nTracks++;
+  data.edep += edep;
    
   return true; 
 }
-
@@ -1,5 +1,8 @@
 #include <iostream>
+#include <cstdlib>
 #include "G4RunManager.hh"
+#include "G4RunManagerFactory.hh"
+#include "G4Threading.hh"
 #include "G4UImanager.hh"
 #include "G4VisManager.hh"
 #include "G4VisExecutive.hh"
@@ -14,8 +17,37 @@
 
 int main(int argc, char **argv)
 {
-  G4RunManager *runManager = new G4RunManager();
-  runManager->SetUserInitialization(new MyDetectorConstruction());
+  // exercise [-t N] [-d N] [-v] [-n N] [macro]
+  //  -t N: number of worker threads (default: all cores). The run manager is
+  //        the tasking one of a multithreaded Geant4 build, G4RUN_MANAGER_TYPE=Serial
+  //        or MT in the environment selects another.
+  //  -d N: ndiv x ndiv detector pads (default 10)
+  //  -v:   virtual readout, a single detector plane with pads computed from
+  //        the hit position (pitch and layout: /exercise/readout/)
+  //  -n N, macro: batch mode, without visualization, executes the macro and/or
+  //        runs N events. Without both, the interactive session is started.
+  G4int nThreads = G4Threading::G4GetNumberOfCores();
+  G4int ndiv = 10;
+  G4bool virtualReadout = false;
+  G4int nEvents = 0;
+  G4String macro;
+  for (G4int i=1; i<argc; i++) {
+    G4String arg = argv[i];
+    if (arg == "-t" && i+1 < argc) nThreads = atoi(argv[++i]);
+    else if (arg == "-d" && i+1 < argc) ndiv = atoi(argv[++i]);
+    else if (arg == "-v") virtualReadout = true;
+    else if (arg == "-n" && i+1 < argc) nEvents = atoi(argv[++i]);
+    else if (arg[0] != '-') macro = arg;
+  }
+  if (ndiv < 1) {
+    G4cerr << "exercise: -d needs a number of pads per row >= 1" << G4endl;
+    return 1;
+  }
+  G4bool batch = nEvents > 0 || !macro.empty();
+
+  G4RunManager *runManager = G4RunManagerFactory::CreateRunManager(G4RunManagerType::Default);
+  runManager->SetNumberOfThreads(nThreads);
+  runManager->SetUserInitialization(new MyDetectorConstruction(ndiv, virtualReadout));
 
   G4PhysListFactory physListFactory;
   G4String plName = "FTFP_BERT";
@@ -26,6 +58,16 @@ int main(int argc, char **argv)
   runManager->SetUserInitialization(new MyActionInitialization());
   runManager->Initialize();
 
+  if (batch) {
+    // no trajectories are stored without visualization
+    G4UImanager *UImanager = G4UImanager::GetUIpointer();
+    UImanager->ApplyCommand("/tracking/storeTrajectory 0");
+    if (!macro.empty()) UImanager->ApplyCommand("/control/execute " + macro);
+    if (nEvents > 0) runManager->BeamOn(nEvents);
+    delete runManager;
+    return 0;
+  }
+
   G4UIExecutive *ui = new G4UIExecutive(argc,argv);
 
   G4VisManager *visManager = new G4VisExecutive();
@@ -1,21 +1,404 @@
 /// This macro provides a simple example on how to use the trained classifier
 /// within an analysis module
+///
+/// Usage:
+///
+///    ./analysis                    (event by event, see the MPPE exercise below)
+///    ./analysis -j 8 [--native [--fourier D]] [--grid] [-m KNN,BDT,...] [--range lo,hi] [-o output file] [data file]
+///                                  (batch mode on 8 threads, 0 = all cores)
+///
+/// In batch mode the events are loaded once into contiguous arrays and
+/// evaluated in blocks by worker threads, each with its own TMVA::Reader in
+/// which all the methods of -m (default KNN) are booked. Every block is
+/// scored by all methods before the next one is taken, so the input is read
+/// and decoded only once however many methods are compared. The output of
+/// every event is written as one column per method (lower-case method name,
+/// e.g. "knn") of the tree "scores", and its distribution to the histogram
+/// "h_<column>", in kNN.root for KNN alone and scores.root otherwise. The
+/// histograms have 100 bins in a fixed range, [0, 1] for KNN as in the
+/// event-by-event mode, see OutputRange for the others, or --range for all.
+///
+/// With --native the KNN, BDT, MLP and SVM weight files are evaluated by
+/// NativeKNN (knn_native.h, an exact k-d tree search giving the TMVA
+/// response), FlatForest (bdt_forest.h), NativeMLP (mlp_native.h) and
+/// NativeSVM (svm_native.h) instead of the Readers. --fourier D replaces the
+/// SVM kernels by D random Fourier features (faster, approximate: the error
+/// on the first events is printed, see svm_native.cpp). They are loaded from
+/// dataset/weights/classification_<Method>.model if that exists and is not
+/// older than the weight file (see model_export.cpp), which is much faster
+/// than the XML weight file.
+///
+/// With --grid the methods tabulated by response_grid.cpp are evaluated by
+/// bilinear interpolation of dataset/weights/classification_<Method>.grid
+/// (constant time per event, check its accuracy first); the others as above.
 
 #include <TFile.h>
 #include <TString.h>
 #include <TSystem.h>
 #include <TROOT.h>
+#include <TH1F.h>
+#include <TTree.h>
+#include <TStopwatch.h>
 
 #include <TMVA/Tools.h>
 #include <TMVA/Reader.h>
 #include <TMVA/MethodCuts.h>
+#include <TMVA/MethodBase.h>
 
+#include<algorithm>
 #include<fstream>
 #include<string>
+#include<vector>
+#include<cstdio>
+#include<cstdlib>
+#include<iostream>
+
+#include "batch_eval.h"
+#include "knn_native.h"
+#include "bdt_forest.h"
+#include "mlp_native.h"
+#include "svm_native.h"
+#include "tmva_weights.h"
+#include "binary_model.h"
+#include "response_grid.h"
 
 using namespace TMVA;
 
-int main(){
+// Events per block of the batch mode
+const size_t kBlockSize = 16384;
+
+// A method scored in batch mode: how it is evaluated, its output column and histogram
+struct ScoredMethod {
+   TString             name;         // e.g. "KNN"
+   TString             weightfile;
+   NativeKNN<2>       *knn;          // native evaluators (--native), else 0
+   FlatForest         *bdt;
+   NativeMLP          *mlp;
+   NativeSVM          *svm;
+   ResponseGrid       *grid;         // tabulated response (--grid), else 0
+   double              aux;          // signal efficiency for the cut methods
+   std::vector<float>  score;        // output of every event
+   TH1F               *hist;
+};
+
+// Per-thread state of the batch mode: a Reader with all non-native methods
+// booked, bound to its own variables (and the buffers of the native
+// evaluators), and the histograms filled by this thread
+struct ReaderWorker {
+   TMVA::Reader                    *reader;
+   std::vector<TMVA::MethodBase*>   methods;      // per scored method, 0 if native
+   Float_t                          var1;
+   Float_t                          var2;
+   NativeKNN<2>::Workspace          knnWs;
+   NativeMLP::Workspace             mlpWs;
+   NativeSVM::Workspace             svmWs;
+   std::vector<double>              buffer;
+   std::vector<TH1F*>               hists;
+};
+
+// Histogram range of the output of a method: [0, 1] for the probability-like
+// outputs, [-1, 1] for the boosted methods, [-2, 2] for the discriminants
+// (LD, Fisher, ...), whose range depends on the data; --range for others
+void OutputRange( const TString& name, double& lo, double& hi )
+{
+   lo = 0;
+   hi = 1;
+   if (name.BeginsWith( "BDT" ) || name.BeginsWith( "Boosted" )) {
+      lo = -1;
+   } else if (name == "LD" || name == "HMatrix" || name.BeginsWith( "Fisher" ) || name.BeginsWith( "FDA" )) {
+      lo = -2;
+      hi =  2;
+   }
+}
+
+int BatchAnalysis( const std::string& dataFile, int nThreads, bool native, int nFourier, bool useGrid,
+                   const TString& methodList, TString outFileName, double rangeLo, double rangeHi )
+{
+   ROOT::EnableThreadSafety();
+
+   nThreads = NumberOfThreads( nThreads );
+
+   // --- Location of training files (as in the event-by-event mode below)
+
+   TString dir    = "dataset/weights/";
+   TString prefix = "classification";
+
+   std::vector<ScoredMethod> methods;
+   std::vector<TString> mlist = TMVA::gTools().SplitString( methodList, ',' );
+   for (size_t m = 0; m < mlist.size(); m++) {
+      ScoredMethod sm;
+      sm.name       = mlist[m];
+      sm.weightfile = dir + prefix + "_" + sm.name + TString(".weights.xml");
+      sm.knn        = 0;
+      sm.bdt        = 0;
+      sm.mlp        = 0;
+      sm.svm        = 0;
+      sm.grid       = 0;
+      sm.aux        = sm.name.BeginsWith( "Cuts" ) ? 0.5 : 0;
+      sm.hist       = 0;
+      methods.push_back( sm );
+   }
+   if (methods.empty()) {
+      std::cout << "==> ERROR: no methods to score" << std::endl;
+      return 1;
+   }
+   if (outFileName == "") outFileName = (methods.size() == 1 && methods[0].name == "KNN") ? "kNN.root" : "scores.root";
+
+   // Native evaluators: one per method, shared read-only by all threads
+   // (from the binary model file written by model_export if there is one).
+   // The method type is the one of the weight file, e.g. Method="BDT::BDTG";
+   // types without a native evaluator go through the Readers.
+   // Tabulated responses, if requested and available, take precedence.
+   for (size_t m = 0; m < methods.size() && useGrid; m++) {
+      ScoredMethod &sm = methods[m];
+      TString gridfile = dir + prefix + "_" + sm.name + TString(".grid");
+      if (gSystem->AccessPathName( gridfile )) {
+         std::cout << "==> No grid for " << sm.name << " (see response_grid.cpp)" << std::endl;
+         continue;
+      }
+      sm.grid = new ResponseGrid;
+      if (!sm.grid->LoadBinary( gridfile.Data() )) return 1;
+   }
+
+   if (native) {
+      for (size_t m = 0; m < methods.size(); m++) {
+         ScoredMethod &sm = methods[m];
+         if (sm.grid) continue;
+         TString modelfile = dir + prefix + "_" + sm.name + TString(".model");
+         bool hasModel = !gSystem->AccessPathName( modelfile );
+
+         // a model exported before the last training would score the old weights
+         FileStat_t modelStat, weightStat;
+         if (hasModel && gSystem->GetPathInfo( modelfile, modelStat ) == 0 &&
+             gSystem->GetPathInfo( sm.weightfile, weightStat ) == 0 && modelStat.fMtime < weightStat.fMtime) {
+            std::cout << "==> " << modelfile << " is older than " << sm.weightfile
+                      << ", not used (run model_export again)" << std::endl;
+            hasModel = false;
+         }
+
+         // the model header gives the type without parsing the XML, which
+         // for KNN holds the whole training sample
+         std::string type;
+         if (hasModel) {
+            BinaryModel model;
+            if (!model.Open( modelfile.Data() )) return 1;
+            switch (model.Type()) {
+               case BinaryModel::kKNN: type = "KNN"; break;
+               case BinaryModel::kBDT: type = "BDT"; break;
+               case BinaryModel::kMLP: type = "MLP"; break;
+               case BinaryModel::kSVM: type = "SVM"; break;
+               default:
+                  std::cout << "==> ERROR: " << modelfile << " is not a KNN, BDT, MLP or SVM model" << std::endl;
+                  return 1;
+            }
+         } else {
+            TMVAWeightsFile wf;
+            if (!wf.Open( sm.weightfile.Data() )) return 1;
+            type = wf.Method().substr( 0, wf.Method().find( "::" ) );
+         }
+
+         if (type == "KNN") {
+            sm.knn = new NativeKNN<2>;
+            if (!(hasModel ? sm.knn->LoadBinary( modelfile.Data() ) : sm.knn->LoadXML( sm.weightfile.Data() ))) return 1;
+         } else if (type == "BDT") {
+            sm.bdt = new FlatForest;
+            if (!(hasModel ? sm.bdt->LoadBinary( modelfile.Data() ) : sm.bdt->LoadXML( sm.weightfile.Data() ))) return 1;
+         } else if (type == "MLP") {
+            sm.mlp = new NativeMLP;
+            if (!(hasModel ? sm.mlp->LoadBinary( modelfile.Data() ) : sm.mlp->LoadXML( sm.weightfile.Data() ))) return 1;
+         } else if (type == "SVM") {
+            sm.svm = new NativeSVM;
+            if (!(hasModel ? sm.svm->LoadBinary( modelfile.Data() ) : sm.svm->LoadXML( sm.weightfile.Data() ))) return 1;
+            sm.svm->SetFourier( nFourier );
+         } else {
+            std::cout << "==> No native evaluator for " << sm.name << " (" << type << "), using the Reader" << std::endl;
+         }
+      }
+   }
+
+   TStopwatch timer;
+
+   // The input is decoded once, for all methods
+   EventData data;
+   if (!LoadEventData( dataFile, data, nThreads )) return 1;
+   size_t nEvents = data.size();
+
+   std::cout << "==> Loading: " << timer.RealTime() << " s" << std::endl;
+
+   for (size_t m = 0; m < methods.size(); m++) methods[m].score.resize( nEvents );
+
+   // Error of the Fourier approximation of the SVM kernels on the first events
+   for (size_t m = 0; m < methods.size(); m++) {
+      if (!methods[m].svm || nFourier <= 0 || nEvents == 0) continue;
+      const float *x[2] = { &data.var1[0], &data.var2[0] };
+      double maxDiff, rms;
+      methods[m].svm->ApproximationError( std::min<size_t>( nEvents, 10000 ), x, maxDiff, rms );
+      std::cout << "==> " << methods[m].name << " with " << nFourier << " Fourier features: max |difference| "
+                << maxDiff << ", RMS " << rms << " to the exact kernels" << std::endl;
+   }
+
+   // One Reader per thread, with all methods that are not evaluated
+   // natively. Booking reads the weight files and is done here, serially; in
+   // the event loop each thread only touches its own Reader.
+   std::vector<ReaderWorker> workers( nThreads );
+   for (int i = 0; i < nThreads; i++) {
+      ReaderWorker &w = workers[i];
+      w.reader = 0;
+      w.methods.assign( methods.size(), (TMVA::MethodBase*) 0 );
+      w.buffer.resize( kBlockSize );
+
+      for (size_t m = 0; m < methods.size(); m++) {
+         ScoredMethod &sm = methods[m];
+         if (sm.knn || sm.bdt || sm.mlp || sm.svm || sm.grid) continue;
+
+         if (!w.reader) {
+            w.reader = new TMVA::Reader( i == 0 ? "!Color:!Silent" : "!Color:Silent" );
+            w.reader->AddVariable( "var1", &w.var1 );
+            w.reader->AddVariable( "var2", &w.var2 );
+         }
+         TString methodName = sm.name + TString(" method");
+         w.methods[m] = dynamic_cast<TMVA::MethodBase*>( w.reader->BookMVA( methodName, sm.weightfile ) );
+         if (!w.methods[m]) {
+            std::cout << "==> ERROR: cannot book " << methodName << " from " << sm.weightfile << std::endl;
+            return 1;
+         }
+      }
+   }
+
+   // Event loop, block by block: every block is evaluated by all methods
+   // while its inputs are in cache. The methods are passed directly, which
+   // saves the lookup by name of EvaluateMVA( "KNN method" ) for every event.
+   timer.Start();
+   ProcessBlocks( nEvents, kBlockSize, nThreads, [&]( int iThread, size_t first, size_t last ) {
+      ReaderWorker &w = workers[iThread];
+      const float *x[2] = { &data.var1[first], &data.var2[first] };
+      size_t n = last - first;
+
+      for (size_t m = 0; m < methods.size(); m++) {
+         ScoredMethod &sm = methods[m];
+         float *score = &sm.score[first];
+         if (sm.grid) {
+            sm.grid->EvaluateBatch( n, x, score );
+         } else if (sm.knn) {
+            sm.knn->EvaluateBatch( n, x, score, w.knnWs );
+         } else if (sm.bdt) {
+            sm.bdt->EvaluateBatch( n, x, &w.buffer[0] );
+            for (size_t i = 0; i < n; i++) score[i] = w.buffer[i];
+         } else if (sm.mlp) {
+            sm.mlp->EvaluateBatch( n, x, score, w.mlpWs );
+         } else if (sm.svm) {
+            sm.svm->EvaluateBatch( n, x, score, w.svmWs );
+         } else {
+            for (size_t i = 0; i < n; i++) {
+               w.var1 = x[0][i];
+               w.var2 = x[1][i];
+               score[i] = w.reader->EvaluateMVA( w.methods[m], sm.aux );
+            }
+         }
+      }
+   } );
+   timer.Stop();
+
+   std::cout << "==> Evaluated " << nEvents << " events x " << methods.size() << " methods on " << nThreads
+             << " threads in " << timer.RealTime() << " s (" << nEvents / std::max( timer.RealTime(), 1e-9 )
+             << " events/s)" << std::endl;
+
+   // Prepare a file to write histograms
+   TFile *file = new TFile( outFileName, "RECREATE" );
+
+   // Histograms, one per method ("h_knn" for KNN), 100 bins in a fixed range
+   // (--range, else the one of the method), so that the histograms of
+   // different runs can be added or compared
+   for (size_t m = 0; m < methods.size(); m++) {
+      ScoredMethod &sm = methods[m];
+      double lo = rangeLo, hi = rangeHi;
+      if (!(hi > lo)) OutputRange( sm.name, lo, hi );
+      TString column = sm.name;
+      column.ToLower();
+      sm.hist = new TH1F( "h_" + column, sm.name + " output;" + sm.name + " output;Events", 100, lo, hi );
+   }
+
+   for (int i = 0; i < nThreads; i++) {
+      for (size_t m = 0; m < methods.size(); m++) {
+         TH1F *h = (TH1F*) methods[m].hist->Clone( Form( "%s_%d", methods[m].hist->GetName(), i ) );
+         h->SetDirectory( 0 );
+         workers[i].hists.push_back( h );
+      }
+   }
+   ProcessBlocks( nEvents, kBlockSize, nThreads, [&]( int iThread, size_t first, size_t last ) {
+      for (size_t m = 0; m < methods.size(); m++)
+         for (size_t i = first; i < last; i++) workers[iThread].hists[m]->Fill( methods[m].score[i] );
+   } );
+
+   // Merge the histograms
+   for (int i = 0; i < nThreads; i++) {
+      for (size_t m = 0; m < methods.size(); m++) {
+         methods[m].hist->Add( workers[i].hists[m] );
+         delete workers[i].hists[m];
+      }
+      delete workers[i].reader;
+   }
+
+   // Output columns: the inputs and one score per method ("knn" for KNN)
+   float var1, var2;
+   std::vector<float> score( methods.size() );
+   TTree *scores = new TTree( "scores", "Classifier outputs per event" );
+   scores->Branch( "var1", &var1, "var1/F" );
+   scores->Branch( "var2", &var2, "var2/F" );
+   for (size_t m = 0; m < methods.size(); m++) {
+      TString column = methods[m].name;
+      column.ToLower();
+      scores->Branch( column, &score[m], column + "/F" );
+   }
+   for (size_t i = 0; i < nEvents; i++) {
+      var1 = data.var1[i];
+      var2 = data.var2[i];
+      for (size_t m = 0; m < methods.size(); m++) score[m] = methods[m].score[i];
+      scores->Fill();
+   }
+
+   // Write histograms and tree
+   file->Write();
+   file->Close();
+
+   for (size_t m = 0; m < methods.size(); m++) {
+      delete methods[m].knn;
+      delete methods[m].bdt;
+      delete methods[m].mlp;
+      delete methods[m].svm;
+      delete methods[m].grid;
+   }
+
+   std::cout << "==> Wrote " << outFileName << std::endl;
+   return 0;
+}
+
+int main( int argc, char** argv ){
+
+   // Batch mode: -j N [--native [--fourier D]] [--grid] [-m Methods] [--range lo,hi] [-o output file] [data file]
+   if (argc > 2 && (std::string( argv[1] ) == "-j" || std::string( argv[1] ) == "--jobs")) {
+      std::string dataFile = "sample_good_separation/data.txt";
+      TString methodList = "KNN", outFileName = "";
+      bool native = false, useGrid = false;
+      int  nFourier = 0;
+      double rangeLo = 0, rangeHi = 0;
+      for (int i = 3; i < argc; i++) {
+         std::string arg( argv[i] );
+         if      (arg == "--native")                                      native = true;
+         else if (arg == "--grid")                                        useGrid = true;
+         else if (arg == "--fourier" && i + 1 < argc)                     nFourier = atoi( argv[++i] );
+         else if ((arg == "-m" || arg == "--methods") && i + 1 < argc)   methodList = argv[++i];
+         else if ((arg == "-o" || arg == "--output") && i + 1 < argc)    outFileName = argv[++i];
+         else if (arg == "--range" && i + 1 < argc) {
+            if (sscanf( argv[++i], "%lf,%lf", &rangeLo, &rangeHi ) != 2 || !(rangeHi > rangeLo)) {
+               std::cout << "==> ERROR: --range lo,hi with lo < hi" << std::endl;
+               return 1;
+            }
+         }
+         else                                                             dataFile = arg;
+      }
+      return BatchAnalysis( dataFile, atoi( argv[2] ), native, nFourier, useGrid, methodList, outFileName, rangeLo, rangeHi );
+   }
 
    // Create the Reader object
   
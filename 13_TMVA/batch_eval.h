@@ -0,0 +1,170 @@
+/// Helpers for the batch (multithreaded) evaluation of trained classifiers
+///
+/// The events of a text file with one "var1 var2" line per event (e.g.
+/// sample_good_separation/data.txt) are loaded once into contiguous arrays,
+/// one per variable. The event range is then cut into fixed-size blocks
+/// which are handed out to the worker threads through an atomic counter:
+///
+///    EventData data;
+///    LoadEventData( "sample_good_separation/data.txt", data, nThreads );
+///    ProcessBlocks( data.size(), 65536, nThreads,
+///                   [&]( int iThread, size_t first, size_t last ) { ... } );
+///
+/// Each worker owns everything it writes to (its TMVA::Reader, histograms),
+/// except for disjoint ranges of the shared output arrays.
+
+#ifndef BATCH_EVAL_H
+#define BATCH_EVAL_H
+
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Input variables of all events, one contiguous array per variable
+struct EventData {
+   std::vector<float> var1;
+   std::vector<float> var2;
+
+   size_t size() const { return var1.size(); }
+};
+
+// Number of worker threads: nThreads, or all cores if nThreads <= 0
+inline int NumberOfThreads( int nThreads )
+{
+   if (nThreads > 0) return nThreads;
+   int nCores = std::thread::hardware_concurrency();
+   return nCores > 0 ? nCores : 1;
+}
+
+// Parse the "var1 var2" lines of text[0, size) into var1/var2. A line that
+// does not start with two numbers (e.g. a "var1/F:var2/F" header) is skipped.
+inline void ParseEventLines( const char* text, size_t size, std::vector<float>& var1, std::vector<float>& var2 )
+{
+   const char *s   = text;
+   const char *end = text + size;
+
+   while (s < end) {
+      const char *eol = (const char*) memchr( s, '\n', end - s );
+      if (!eol) eol = end;
+
+      float v[2];
+      int   nv = 0;
+      const char *p = s;
+      while (nv < 2) {
+         while (p < eol && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+         std::from_chars_result res = std::from_chars( p, eol, v[nv] );
+         if (res.ec != std::errc()) break;
+         p = res.ptr;
+         nv++;
+      }
+      if (nv == 2) {
+         var1.push_back( v[0] );
+         var2.push_back( v[1] );
+      }
+
+      s = eol + 1;
+   }
+}
+
+// Load all events of fileName. The file is memory-mapped and cut at line
+// starts into one chunk per thread, which are parsed in parallel and
+// concatenated in file order. Returns false if the file cannot be read.
+inline bool LoadEventData( const std::string& fileName, EventData& data, int nThreads = 0 )
+{
+   int fd = open( fileName.c_str(), O_RDONLY );
+   struct stat st;
+   if (fd < 0 || fstat( fd, &st ) != 0) {
+      std::cout << "==> ERROR: cannot open data file " << fileName << std::endl;
+      if (fd >= 0) close( fd );
+      return false;
+   }
+
+   size_t size = st.st_size;
+   data.var1.clear();
+   data.var2.clear();
+   if (size == 0) {
+      close( fd );
+      return true;
+   }
+
+   const char *text = (const char*) mmap( 0, size, PROT_READ, MAP_PRIVATE, fd, 0 );
+   close( fd );
+   if (text == MAP_FAILED) {
+      std::cout << "==> ERROR: cannot map data file " << fileName << std::endl;
+      return false;
+   }
+   madvise( (void*) text, size, MADV_SEQUENTIAL );
+
+   nThreads = NumberOfThreads( nThreads );
+
+   // chunk boundaries, moved forward to the next line start
+   std::vector<size_t> start( nThreads + 1, size );
+   start[0] = 0;
+   for (int i = 1; i < nThreads; i++) {
+      size_t pos = std::max( start[i-1], size * i / nThreads );
+      while (pos < size && pos > 0 && text[pos-1] != '\n') pos++;
+      start[i] = pos;
+   }
+
+   std::vector< std::vector<float> > chunk1( nThreads ), chunk2( nThreads );
+   std::vector<std::thread> workers;
+   for (int i = 0; i < nThreads; i++) {
+      workers.push_back( std::thread( [&, i]() {
+         ParseEventLines( text + start[i], start[i+1] - start[i], chunk1[i], chunk2[i] );
+      } ) );
+   }
+   for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+
+   munmap( (void*) text, size );
+
+   size_t nEvents = 0;
+   for (int i = 0; i < nThreads; i++) nEvents += chunk1[i].size();
+   data.var1.reserve( nEvents );
+   data.var2.reserve( nEvents );
+   for (int i = 0; i < nThreads; i++) {
+      data.var1.insert( data.var1.end(), chunk1[i].begin(), chunk1[i].end() );
+      data.var2.insert( data.var2.end(), chunk2[i].begin(), chunk2[i].end() );
+      std::vector<float>().swap( chunk1[i] );
+      std::vector<float>().swap( chunk2[i] );
+   }
+
+   std::cout << "==> Loaded " << nEvents << " events from " << fileName << std::endl;
+   return true;
+}
+
+// Call process( iThread, first, last ) for all blocks [first, last) of
+// blockSize events in [0, nEvents), on nThreads worker threads. Blocks are
+// taken dynamically, so uneven block costs are balanced between the workers.
+template <typename Func>
+void ProcessBlocks( size_t nEvents, size_t blockSize, int nThreads, Func process )
+{
+   nThreads = NumberOfThreads( nThreads );
+   size_t nBlocks = (nEvents + blockSize - 1) / blockSize;
+   if ((size_t) nThreads > nBlocks) nThreads = std::max<size_t>( nBlocks, 1 );
+
+   std::atomic<size_t> nextBlock( 0 );
+
+   std::vector<std::thread> workers;
+   for (int iThread = 0; iThread < nThreads; iThread++) {
+      workers.push_back( std::thread( [&, iThread]() {
+         for (size_t iBlock = nextBlock++; iBlock < nBlocks; iBlock = nextBlock++) {
+            size_t first = iBlock * blockSize;
+            size_t last  = std::min( first + blockSize, nEvents );
+            process( iThread, first, last );
+         }
+      } ) );
+   }
+   for (size_t i = 0; i < workers.size(); i++) workers[i].join();
+}
+
+#endif
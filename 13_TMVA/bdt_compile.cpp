@@ -0,0 +1,111 @@
+/// Compiles a trained BDT into a flat forest (bdt_forest.h) and checks it
+///
+/// Reads dataset/weights/classification_<Method>.weights.xml, evaluates the
+/// events of a data file with TMVA::Reader and with the flat forest, and
+/// prints the largest difference of the responses and the time per event.
+/// With -o, the forest is also written as a generated C++ header that can
+/// be included in an analysis instead of booking the method.
+///
+///     make -f Makefile_bdt_compile
+///     ./bdt_compile [-o classification_BDT.h] [Method] [data file] [number of events compared]
+///
+/// The defaults are BDT, sample_good_separation/data.txt and 10000 events.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <TString.h>
+#include <TStopwatch.h>
+
+#include <TMVA/Reader.h>
+#include <TMVA/MethodBase.h>
+
+#include "batch_eval.h"
+#include "bdt_forest.h"
+
+int main( int argc, char** argv )
+{
+   std::string header;
+   std::vector<std::string> args;
+   for (int i = 1; i < argc; i++) {
+      if (std::string( argv[i] ) == "-o" && i + 1 < argc) header = argv[++i];
+      else args.push_back( argv[i] );
+   }
+   std::string method   = (args.size() > 0) ? args[0] : "BDT";
+   std::string dataFile = (args.size() > 1) ? args[1] : "sample_good_separation/data.txt";
+   size_t      nCompare = (args.size() > 2) ? atol( args[2].c_str() ) : 10000;
+
+   std::string weightfile = "dataset/weights/classification_" + method + ".weights.xml";
+
+   // --- flat forest
+   FlatForest forest;
+   if (!forest.LoadXML( weightfile )) return 1;
+   if (forest.GetNVar() != 2) {
+      std::cout << "==> ERROR: " << weightfile << ": expected the 2 variables var1, var2" << std::endl;
+      return 1;
+   }
+   if (header != "" && !forest.WriteCpp( header, "classification_" + method )) return 1;
+
+   EventData data;
+   if (!LoadEventData( dataFile, data )) return 1;
+   nCompare = std::min( nCompare, data.size() );
+
+   TStopwatch timer;
+
+   std::vector<double> flatOut( data.size() );
+   const float *x[2] = { &data.var1[0], &data.var2[0] };
+   timer.Start();
+   forest.EvaluateBatch( data.size(), x, &flatOut[0] );
+   timer.Stop();
+   double batchTime = timer.RealTime() / data.size();
+
+   double sum = 0;
+   timer.Start();
+   for (size_t i = 0; i < data.size(); i++) {
+      float xi[2] = { data.var1[i], data.var2[i] };
+      sum += forest.Evaluate( xi );
+   }
+   timer.Stop();
+   double singleTime = timer.RealTime() / data.size();
+
+   // --- TMVA
+   Float_t var1, var2;
+   TMVA::Reader *reader = new TMVA::Reader( "!Color:Silent" );
+   reader->AddVariable( "var1", &var1 );
+   reader->AddVariable( "var2", &var2 );
+   TMVA::MethodBase *tmva = dynamic_cast<TMVA::MethodBase*>( reader->BookMVA( method + " method", weightfile ) );
+   if (!tmva) {
+      std::cout << "==> ERROR: cannot book " << method << " from " << weightfile << std::endl;
+      return 1;
+   }
+
+   std::vector<double> tmvaOut( nCompare );
+   timer.Start();
+   for (size_t i = 0; i < nCompare; i++) {
+      var1 = data.var1[i];
+      var2 = data.var2[i];
+      tmvaOut[i] = reader->EvaluateMVA( tmva );
+   }
+   timer.Stop();
+   double tmvaTime = timer.RealTime() / std::max<size_t>( nCompare, 1 );
+
+   // --- comparison
+   double maxDiff = 0;
+   size_t nDiff   = 0;
+   for (size_t i = 0; i < nCompare; i++) {
+      double diff = fabs( tmvaOut[i] - flatOut[i] );
+      maxDiff = std::max( maxDiff, diff );
+      if (diff > 1e-9) nDiff++;
+   }
+
+   std::cout << "==> Compared " << nCompare << " events: " << nDiff << " differ, max |difference| = " << maxDiff << std::endl;
+   std::cout << "==> Per event: TMVA " << tmvaTime * 1e6 << " us, flat " << singleTime * 1e6
+             << " us, flat batch " << batchTime * 1e6 << " us (x" << tmvaTime / std::max( batchTime, 1e-12 ) << ")"
+             << " [checksum " << sum << "]" << std::endl;
+
+   delete reader;
+   return nDiff == 0 ? 0 : 1;
+}
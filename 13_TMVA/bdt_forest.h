@@ -0,0 +1,401 @@
+/// Flat evaluator of the TMVA boosted decision trees (BDT, BDTG, BDTB)
+///
+/// The forest of a BDT weight file is converted into plain arrays. Every tree
+/// is padded to a complete binary tree of the depth of the deepest tree (a
+/// leaf above that depth is repeated below a dummy node), and the children
+/// are swapped where TMVA selects on "value < cut" (cType=0). Walking a tree
+/// is then the same fixed sequence for every event:
+///
+///    node = 2*node + 1 + (x[var[node]] >= cut[node])        (depth times)
+///
+/// with no pointers and no data-dependent branches. EvaluateBatch runs each
+/// tree over a block of events before going to the next tree, so that the
+/// tree stays in L1 cache while the block streams through it.
+///
+///    FlatForest bdt;
+///    bdt.LoadXML( "dataset/weights/classification_BDT.weights.xml" );
+///    double response = bdt.Evaluate( x );               // x[0..NVar-1]
+///    bdt.WriteCpp( "classification_BDT.h", "classification_BDT" );
+///
+/// The response is the one of TMVA::MethodBDT, summed in the same order:
+///
+///    AdaBoost, Bagging:  sum_t boostWeight_t * nType_t / sum_t boostWeight_t
+///                        (purity instead of nType with UseYesNoLeaf=F)
+///    Grad:               2/(1 + exp(-2 sum_t res_t)) - 1
+///
+/// WriteCpp generates a self-contained header with the forest as constant
+/// arrays; including it in an analysis needs neither TMVA nor the XML file.
+/// WriteBinary/LoadBinary save and restore the flat arrays as a binary model
+/// file (binary_model.h). Fisher cuts (UseFisherCuts), input variable
+/// transformations and the other boost types are not supported.
+
+#ifndef BDT_FOREST_H
+#define BDT_FOREST_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstdio>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "tmva_weights.h"
+#include "binary_model.h"
+
+class FlatForest {
+
+public:
+
+   static const int    kMaxDepth  = 16;
+   static const size_t kBlockSize = 256;  // events per block in EvaluateBatch
+
+   enum EBoost { kAdaBoost, kGrad };
+
+   FlatForest() : fBoost( kAdaBoost ), fNVar( 0 ), fDepth( 0 ), fNTrees( 0 ), fNorm( 0 ) {}
+
+   // ---------------------------------------------------------------------------
+
+   bool LoadXML( const std::string& fileName )
+   {
+      TMVAWeightsFile wf;
+      if (!wf.Open( fileName )) return false;
+
+      if (wf.Method().compare( 0, 5, "BDT::" ) != 0) {
+         std::cout << "==> ERROR: " << fileName << " is not a BDT weight file" << std::endl;
+         return false;
+      }
+      if (wf.AttrI( wf.Child( wf.Root(), "Transformations" ), "NTransformations" ) > 0) {
+         std::cout << "==> ERROR: " << fileName << ": input variable transformations are not supported" << std::endl;
+         return false;
+      }
+
+      std::string boostType = wf.Option( "BoostType" );
+      if (boostType == "AdaBoost" || boostType == "Bagging") fBoost = kAdaBoost;
+      else if (boostType == "Grad")                          fBoost = kGrad;
+      else {
+         std::cout << "==> ERROR: " << fileName << ": BoostType=" << boostType << " is not supported" << std::endl;
+         return false;
+      }
+      bool useYesNoLeaf = (wf.Option( "UseYesNoLeaf" ) == "") || wf.OptionB( "UseYesNoLeaf" );
+
+      fNVar = wf.Variables().size();
+
+      // read the trees into a temporary pointer-free form
+      std::vector< std::vector<XMLNode> > trees;
+      std::vector<double> boostWeights;
+      XMLNodePointer_t weights = wf.Child( wf.Root(), "Weights" );
+      for (XMLNodePointer_t bt = wf.Child( weights, "BinaryTree" ); bt; bt = wf.Next( bt, "BinaryTree" )) {
+         trees.push_back( std::vector<XMLNode>() );
+         if (!ReadNode( wf, wf.Child( bt, "Node" ), trees.back() )) {
+            std::cout << "==> ERROR: " << fileName << ": cannot read tree " << trees.size() - 1 << std::endl;
+            return false;
+         }
+         boostWeights.push_back( wf.AttrD( bt, "boostWeight" ) );
+      }
+
+      fNTrees = trees.size();
+      fDepth  = 0;
+      for (int t = 0; t < fNTrees; t++) fDepth = std::max( fDepth, TreeDepth( trees[t], 0 ) );
+      if (fNTrees == 0 || fDepth > kMaxDepth) {
+         std::cout << "==> ERROR: " << fileName << ": " << fNTrees << " trees of depth " << fDepth << std::endl;
+         return false;
+      }
+      for (int t = 0; t < fNTrees; t++) {
+         for (size_t i = 0; i < trees[t].size(); i++) {
+            const XMLNode &node = trees[t][i];
+            if (node.left >= 0 && (node.var < 0 || node.var >= fNVar || node.var > 255)) {
+               std::cout << "==> ERROR: " << fileName << ": tree " << t << " cuts on variable " << node.var << std::endl;
+               return false;
+            }
+         }
+      }
+
+      // complete trees of depth fDepth
+      size_t nInternal = NInternal(), nLeaves = NLeaves();
+      fVar.assign( fNTrees * nInternal, 0 );
+      fCut.assign( fNTrees * nInternal, 0.0f );
+      fLeaf.assign( fNTrees * nLeaves, 0.0 );
+      fNorm = 0;
+
+      for (int t = 0; t < fNTrees; t++) {
+         double scale = (fBoost == kAdaBoost) ? boostWeights[t] : 1.0;
+         Flatten( trees[t], 0, 0, 0, t, scale, useYesNoLeaf );
+         fNorm += boostWeights[t];
+      }
+
+      std::cout << "==> FlatForest: " << fNTrees << " trees of depth " << fDepth << ", "
+                << (fBoost == kGrad ? "Grad" : "AdaBoost") << ", " << fNVar << " variables" << std::endl;
+      return true;
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // response for the event with input variables x[0..NVar-1]
+   double Evaluate( const float* x ) const
+   {
+      size_t nInternal = NInternal();
+      double sum = 0;
+      for (int t = 0; t < fNTrees; t++) {
+         const uint8_t *var = &fVar[t * nInternal];
+         const float   *cut = &fCut[t * nInternal];
+         size_t node = 0;
+         for (int d = 0; d < fDepth; d++) node = 2*node + 1 + (x[var[node]] >= cut[node]);
+         sum += fLeaf[t * NLeaves() + node - nInternal];
+      }
+      return Response( sum );
+   }
+
+   // responses of n events, variable v of event i in x[v][i]
+   void EvaluateBatch( size_t n, const float* const* x, double* response ) const
+   {
+      size_t nInternal = NInternal(), nLeaves = NLeaves();
+      uint32_t node[kBlockSize];
+      double   sum[kBlockSize];
+
+      for (size_t first = 0; first < n; first += kBlockSize) {
+         size_t nb = std::min( kBlockSize, n - first );
+         for (size_t i = 0; i < nb; i++) sum[i] = 0;
+
+         for (int t = 0; t < fNTrees; t++) {
+            const uint8_t *var  = &fVar[t * nInternal];
+            const float   *cut  = &fCut[t * nInternal];
+            const double  *leaf = &fLeaf[t * nLeaves];
+
+            for (size_t i = 0; i < nb; i++) node[i] = 0;
+            for (int d = 0; d < fDepth; d++) {
+               for (size_t i = 0; i < nb; i++) {
+                  uint32_t k = node[i];
+                  node[i] = 2*k + 1 + (x[var[k]][first + i] >= cut[k]);
+               }
+            }
+            for (size_t i = 0; i < nb; i++) sum[i] += leaf[node[i] - nInternal];
+         }
+
+         for (size_t i = 0; i < nb; i++) response[first + i] = Response( sum[i] );
+      }
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // header with the forest as constant arrays and
+   //    double <name>::Evaluate( const float* x )
+   bool WriteCpp( const std::string& fileName, const std::string& name ) const
+   {
+      FILE *out = fopen( fileName.c_str(), "w" );
+      if (!out) {
+         std::cout << "==> ERROR: cannot write " << fileName << std::endl;
+         return false;
+      }
+
+      size_t nInternal = NInternal(), nLeaves = NLeaves();
+
+      fprintf( out, "// %s: %d trees of depth %d, generated by bdt_compile (see bdt_forest.h)\n\n", name.c_str(), fNTrees, fDepth );
+      fprintf( out, "#ifndef %s_GENERATED_H\n#define %s_GENERATED_H\n\n", name.c_str(), name.c_str() );
+      fprintf( out, "#include <cmath>\n\nnamespace %s {\n\n", name.c_str() );
+      fprintf( out, "const int kNVar = %d;\nconst int kNTrees = %d;\nconst int kDepth = %d;\n\n", fNVar, fNTrees, fDepth );
+
+      fprintf( out, "const unsigned char kVar[%zu] = {", fVar.size() );
+      for (size_t i = 0; i < fVar.size(); i++) fprintf( out, "%s%d", Separator( i, nInternal ), fVar[i] );
+      fprintf( out, "\n};\n\n" );
+
+      fprintf( out, "const float kCut[%zu] = {", fCut.size() );
+      for (size_t i = 0; i < fCut.size(); i++) fprintf( out, "%s%.9g", Separator( i, nInternal ), fCut[i] );
+      fprintf( out, "\n};\n\n" );
+
+      fprintf( out, "const double kLeaf[%zu] = {", fLeaf.size() );
+      for (size_t i = 0; i < fLeaf.size(); i++) fprintf( out, "%s%.17g", Separator( i, nLeaves ), fLeaf[i] );
+      fprintf( out, "\n};\n\n" );
+
+      fprintf( out, "inline double Evaluate( const float* x )\n{\n" );
+      fprintf( out, "   double sum = 0;\n" );
+      fprintf( out, "   for (int t = 0; t < kNTrees; t++) {\n" );
+      fprintf( out, "      const unsigned char *var = &kVar[t * %zu];\n", nInternal );
+      fprintf( out, "      const float         *cut = &kCut[t * %zu];\n", nInternal );
+      fprintf( out, "      unsigned node = 0;\n" );
+      for (int d = 0; d < fDepth; d++)
+         fprintf( out, "      node = 2*node + 1 + (x[var[node]] >= cut[node]);\n" );
+      fprintf( out, "      sum += kLeaf[t * %zu + node - %zu];\n", nLeaves, nInternal );
+      fprintf( out, "   }\n" );
+      if (fBoost == kGrad)
+         fprintf( out, "   return 2.0/(1.0 + std::exp(-2.0*sum)) - 1;\n" );
+      else
+         fprintf( out, "   return %.17g > %.17g ? sum / %.17g : 0;\n", fNorm, std::numeric_limits<double>::epsilon(), fNorm );
+      fprintf( out, "}\n\n} // namespace %s\n\n#endif\n", name.c_str() );
+
+      fclose( out );
+      std::cout << "==> Wrote " << fileName << std::endl;
+      return true;
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // binary model file with the flat forest
+   bool WriteBinary( const std::string& fileName ) const
+   {
+      std::vector<double> params;
+      params.push_back( fBoost );
+      params.push_back( fDepth );
+      params.push_back( fNTrees );
+      params.push_back( fNorm );
+
+      BinaryModelWriter out( BinaryModel::kBDT, fNVar );
+      out.Add( kParams, params );
+      out.Add( kVar,    fVar );
+      out.Add( kCut,    fCut );
+      out.Add( kLeaf,   fLeaf );
+      return out.Write( fileName );
+   }
+
+   bool LoadBinary( const std::string& fileName )
+   {
+      BinaryModel in;
+      if (!in.Open( fileName )) return false;
+      if (in.Type() != BinaryModel::kBDT) {
+         std::cout << "==> ERROR: " << fileName << " is not a BDT model" << std::endl;
+         return false;
+      }
+
+      std::vector<double> params;
+      if (!in.Get( kParams, params ) || params.size() != 4) return false;
+      // same limits as LoadXML, checked before the shifts in NInternal()/NLeaves()
+      if ((params[0] != kAdaBoost && params[0] != kGrad) || !(params[1] >= 0 && params[1] <= kMaxDepth)
+          || !(params[2] >= 1 && params[2] <= std::numeric_limits<int>::max()) || in.NVar() < 1 || in.NVar() > 256) {
+         std::cout << "==> ERROR: " << fileName << ": " << params[2] << " trees of depth " << params[1]
+                   << " on " << in.NVar() << " variables" << std::endl;
+         return false;
+      }
+      fBoost  = (EBoost) (int) params[0];
+      fDepth  = params[1];
+      fNTrees = params[2];
+      fNorm   = params[3];
+      fNVar   = in.NVar();
+
+      if (!in.Get( kVar, fVar ) || !in.Get( kCut, fCut ) || !in.Get( kLeaf, fLeaf )) return false;
+      if (fVar.size() != fNTrees * NInternal() || fCut.size() != fVar.size() || fLeaf.size() != fNTrees * NLeaves()) {
+         std::cout << "==> ERROR: " << fileName << ": inconsistent forest" << std::endl;
+         return false;
+      }
+      for (size_t i = 0; i < fVar.size(); i++) {
+         if (fVar[i] >= fNVar) {
+            std::cout << "==> ERROR: " << fileName << ": node " << i << " cuts on variable " << int(fVar[i]) << std::endl;
+            return false;
+         }
+      }
+      return true;
+   }
+
+   int GetNTrees() const { return fNTrees; }
+   int GetDepth()  const { return fDepth; }
+   int GetNVar()   const { return fNVar; }
+
+private:
+
+   // sections of the binary model file
+   enum { kParams = 1, kVar, kCut, kLeaf };
+
+   // node as read from the XML file; children are indices, -1 for leaves
+   struct XMLNode {
+      int    var;
+      float  cut;
+      bool   cutType;
+      int    nodeType;
+      double purity;
+      double response;
+      int    left;
+      int    right;
+   };
+
+   EBoost fBoost;
+   int    fNVar;
+   int    fDepth;
+   int    fNTrees;
+   double fNorm;    // sum of the boost weights
+
+   // tree t: internal nodes [t*NInternal(), (t+1)*NInternal()), heap order
+   std::vector<uint8_t> fVar;
+   std::vector<float>   fCut;
+   std::vector<double>  fLeaf;   // boostWeight * leaf value, NLeaves() per tree
+
+   size_t NInternal() const { return (size_t(1) << fDepth) - 1; }
+   size_t NLeaves()   const { return  size_t(1) << fDepth; }
+
+   double Response( double sum ) const
+   {
+      if (fBoost == kGrad) return 2.0/(1.0 + exp(-2.0*sum)) - 1;
+      return fNorm > std::numeric_limits<double>::epsilon() ? sum / fNorm : 0;
+   }
+
+   static const char* Separator( size_t i, size_t perTree )
+   {
+      if (i == 0) return "\n   ";
+      return (i % perTree == 0) ? ",\n   " : ", ";
+   }
+
+   // <Node pos="s|l|r" IVar Cut cType nType purity res NCoef> with its children
+   static bool ReadNode( const TMVAWeightsFile& wf, XMLNodePointer_t xml, std::vector<XMLNode>& nodes )
+   {
+      if (!xml || wf.AttrI( xml, "NCoef" ) > 0) return false; // Fisher cuts
+
+      int index = nodes.size();
+      XMLNode node;
+      node.var      = wf.AttrI( xml, "IVar" );
+      node.cut      = strtof( wf.Attr( xml, "Cut" ).c_str(), 0 );
+      node.cutType  = wf.AttrI( xml, "cType" ) != 0;
+      node.nodeType = wf.AttrI( xml, "nType" );
+      node.purity   = strtof( wf.Attr( xml, "purity" ).c_str(), 0 ); // Float_t in TMVA
+      node.response = strtof( wf.Attr( xml, "res" ).c_str(), 0 );
+      node.left     = -1;
+      node.right    = -1;
+      nodes.push_back( node );
+
+      for (XMLNodePointer_t child = wf.Child( xml, "Node" ); child; child = wf.Next( child, "Node" )) {
+         int childIndex = nodes.size();
+         if (!ReadNode( wf, child, nodes )) return false;
+         if (wf.Attr( child, "pos" ) == "l") nodes[index].left  = childIndex;
+         else                                nodes[index].right = childIndex;
+      }
+
+      // internal nodes have both children, leaves none
+      return (nodes[index].left < 0) == (nodes[index].right < 0);
+   }
+
+   static int TreeDepth( const std::vector<XMLNode>& nodes, int i )
+   {
+      if (nodes[i].left < 0) return 0;
+      return 1 + std::max( TreeDepth( nodes, nodes[i].left ), TreeDepth( nodes, nodes[i].right ) );
+   }
+
+   // copy XML node i to position pos (heap order, level depth) of tree t
+   void Flatten( const std::vector<XMLNode>& nodes, int i, size_t pos, int depth, int t, double scale, bool useYesNoLeaf )
+   {
+      const XMLNode &node = nodes[i];
+      size_t nInternal = NInternal();
+
+      if (depth == fDepth) {
+         double value = (fBoost == kGrad) ? node.response : (useYesNoLeaf ? node.nodeType : node.purity);
+         fLeaf[t * NLeaves() + pos - nInternal] = scale * value;
+         return;
+      }
+
+      if (node.left < 0) {
+         // leaf above the full depth: dummy node, same leaf on both sides
+         Flatten( nodes, i, 2*pos + 1, depth + 1, t, scale, useYesNoLeaf );
+         Flatten( nodes, i, 2*pos + 2, depth + 1, t, scale, useYesNoLeaf );
+         return;
+      }
+
+      // TMVA goes right if (x >= cut) == cType: swap the children for cType=0
+      fVar[t * nInternal + pos] = node.var;
+      fCut[t * nInternal + pos] = node.cut;
+      int right = node.cutType ? node.right : node.left;
+      int left  = node.cutType ? node.left  : node.right;
+      Flatten( nodes, left,  2*pos + 1, depth + 1, t, scale, useYesNoLeaf );
+      Flatten( nodes, right, 2*pos + 2, depth + 1, t, scale, useYesNoLeaf );
+   }
+
+};
+
+#endif
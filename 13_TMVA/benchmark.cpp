@@ -0,0 +1,308 @@
+/// Cost of the TMVA classifiers: training time, memory and response latency
+///
+/// For every method enabled in the Use map of classification.cpp (or the
+/// methods given on the command line) the benchmark
+///
+///  - trains it alone, as "./classification --train-only <Method>" in a child
+///    process, and records the wall clock time, the CPU time and the peak
+///    resident memory (RSS) of that process;
+///  - records the size of its weight file;
+///  - books it in a TMVA::Reader and evaluates the events of data.txt one at
+///    a time (the Reader has no batch interface), timing every event;
+///  - for KNN, BDT, MLP and SVM, evaluates them with the native evaluators
+///    of analysis --native (engine "native"), and with the tabulated
+///    response of response_grid.cpp if there is one (engine "grid"), in
+///    batches of 1, 16, 256 and 4096 events, timing every batch.
+///
+/// Every timed call (one event for the Reader, one batch otherwise) is a
+/// latency sample, from which the median (p50) and the 99th percentile (p99)
+/// are taken; the mean time per event is also given. The results are written
+/// to benchmark.csv, one line per method, engine and batch size.
+///
+///     make -f Makefile_classification
+///     make -f Makefile_benchmark
+///     ./benchmark [--no-train] [--data data file] [Methods]
+///
+/// --no-train skips the training and uses the existing weight files (the
+/// training columns are then empty).
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <TString.h>
+
+#include <TMVA/Reader.h>
+#include <TMVA/MethodBase.h>
+
+#include "batch_eval.h"
+#include "knn_native.h"
+#include "bdt_forest.h"
+#include "mlp_native.h"
+#include "svm_native.h"
+#include "response_grid.h"
+#include "tmva_weights.h"
+
+// Events timed per engine and batch size (at least 10 batches)
+const size_t kMaxEvents = 20000;
+
+struct Latency {
+   size_t events;
+   double p50;         // us per call
+   double p99;         // us per call
+   double perEvent;    // us, mean
+};
+
+struct TrainCost {
+   bool   measured;
+   double wallTime;    // s
+   double cpuTime;     // s, user + system
+   double peakRSS;     // MB
+};
+
+// Methods enabled in classification.cpp
+std::vector<std::string> EnabledMethods()
+{
+   std::vector<std::string> methods;
+   FILE *list = popen( "./classification --list", "r" );
+   if (!list) return methods;
+
+   char line[256];
+   while (fgets( line, sizeof(line), list )) {
+      std::string name( line );
+      while (!name.empty() && isspace( name[name.size() - 1] )) name.erase( name.size() - 1 );
+      bool isName = !name.empty();
+      for (size_t i = 0; i < name.size(); i++) isName = isName && (isalnum( name[i] ) || name[i] == '_');
+      if (isName) methods.push_back( name );
+   }
+   pclose( list );
+   return methods;
+}
+
+// Train method alone in a child process; its resource usage from wait4
+TrainCost TrainMethod( const std::string& method )
+{
+   TrainCost cost = { false, 0, 0, 0 };
+
+   std::string logName = "benchmark_" + method + ".log";
+   std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+   pid_t pid = fork();
+   if (pid == 0) {
+      int fd = open( logName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644 );
+      if (fd >= 0) {
+         dup2( fd, 1 );
+         dup2( fd, 2 );
+         close( fd );
+      }
+      execl( "./classification", "classification", "--train-only", method.c_str(), (char*)0 );
+      perror( "execl" );
+      _exit( 127 );
+   }
+   if (pid < 0) {
+      perror( "fork" );
+      return cost;
+   }
+
+   int status = 0;
+   struct rusage usage;
+   if (wait4( pid, &status, 0, &usage ) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+      std::cout << "==> ERROR: training of " << method << " failed, see " << logName << std::endl;
+      return cost;
+   }
+
+   cost.measured = true;
+   cost.wallTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+   cost.cpuTime  = usage.ru_utime.tv_sec + 1e-6 * usage.ru_utime.tv_usec +
+                   usage.ru_stime.tv_sec + 1e-6 * usage.ru_stime.tv_usec;
+   cost.peakRSS  = usage.ru_maxrss / 1024.;   // kB on Linux
+   return cost;
+}
+
+// p-th percentile (0-100) of the samples
+double Percentile( std::vector<double> samples, double p )
+{
+   if (samples.empty()) return 0;
+   size_t k = std::min( samples.size() - 1, (size_t) (p / 100. * samples.size()) );
+   std::nth_element( samples.begin(), samples.begin() + k, samples.end() );
+   return samples[k];
+}
+
+// Time evaluate( first, n ) on consecutive batches of batchSize events
+template <typename Func>
+Latency TimeCalls( size_t nData, size_t batchSize, Func evaluate )
+{
+   size_t nEvents = std::min( nData, std::max( kMaxEvents, 10 * batchSize ) );
+   nEvents -= nEvents % batchSize;
+
+   std::vector<double> samples;
+   double total = 0;
+   for (size_t first = 0; first + batchSize <= nEvents; first += batchSize) {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      evaluate( first, batchSize );
+      double t = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+      samples.push_back( t );
+      total += t;
+   }
+
+   Latency l = { nEvents, Percentile( samples, 50 ) * 1e6, Percentile( samples, 99 ) * 1e6,
+                 nEvents > 0 ? total / nEvents * 1e6 : 0 };
+   return l;
+}
+
+int main( int argc, char** argv )
+{
+   bool train = true;
+   std::string dataFile = "sample_good_separation/data.txt";
+   std::vector<std::string> methods;
+   for (int i = 1; i < argc; i++) {
+      std::string arg( argv[i] );
+      if      (arg == "--no-train")             train = false;
+      else if (arg == "--data" && i + 1 < argc) dataFile = argv[++i];
+      else                                      methods.push_back( arg );
+   }
+   if (methods.empty()) methods = EnabledMethods();
+   if (methods.empty()) {
+      std::cout << "==> ERROR: no methods (is ./classification built?)" << std::endl;
+      return 1;
+   }
+
+   EventData data;
+   if (!LoadEventData( dataFile, data )) return 1;
+
+   FILE *csv = fopen( "benchmark.csv", "w" );
+   if (!csv) {
+      std::cout << "==> ERROR: cannot write benchmark.csv" << std::endl;
+      return 1;
+   }
+   fprintf( csv, "method,engine,train_wall_s,train_cpu_s,train_peak_rss_mb,weight_file_bytes,"
+                 "batch_size,events,call_p50_us,call_p99_us,mean_us_per_event\n" );
+
+   const size_t batchSizes[] = { 1, 16, 256, 4096 };
+   const size_t nBatchSizes  = sizeof(batchSizes) / sizeof(batchSizes[0]);
+
+   for (size_t m = 0; m < methods.size(); m++) {
+      const std::string &method = methods[m];
+      std::cout << "==> Benchmarking " << method << std::endl;
+
+      TrainCost cost = { false, 0, 0, 0 };
+      if (train) {
+         cost = TrainMethod( method );
+         if (!cost.measured) continue;
+      }
+
+      std::string weightfile = "dataset/weights/classification_" + method + ".weights.xml";
+      struct stat st;
+      if (stat( weightfile.c_str(), &st ) != 0) {
+         std::cout << "==> ERROR: no weight file " << weightfile << std::endl;
+         continue;
+      }
+
+      Float_t var1, var2;
+      TMVA::Reader *reader = new TMVA::Reader( "!Color:Silent" );
+      reader->AddVariable( "var1", &var1 );
+      reader->AddVariable( "var2", &var2 );
+      TMVA::MethodBase *mva = dynamic_cast<TMVA::MethodBase*>( reader->BookMVA( method + " method", weightfile ) );
+      if (!mva) {
+         std::cout << "==> ERROR: cannot book " << method << std::endl;
+         delete reader;
+         continue;
+      }
+      // the cut methods return the decision at a given signal efficiency
+      double aux = (method.compare( 0, 4, "Cuts" ) == 0) ? 0.5 : 0;
+
+      auto report = [&]( const char* engine, size_t batchSize, const Latency& l, double sum ) {
+         if (cost.measured)
+            fprintf( csv, "%s,%s,%.3f,%.3f,%.1f,", method.c_str(), engine, cost.wallTime, cost.cpuTime, cost.peakRSS );
+         else
+            fprintf( csv, "%s,%s,,,,", method.c_str(), engine );
+         fprintf( csv, "%lld,%zu,%zu,%.4f,%.4f,%.4f\n", (long long) st.st_size, batchSize, l.events, l.p50, l.p99, l.perEvent );
+
+         std::cout << "==>   " << engine << ", batch " << batchSize << ": p50 " << l.p50 << " us, p99 " << l.p99
+                   << " us per call, " << l.perEvent << " us per event [checksum " << sum << "]" << std::endl;
+      };
+
+      // Reader: every event timed alone
+      double sum = 0;
+      Latency l = TimeCalls( data.size(), 1, [&]( size_t first, size_t ) {
+         var1 = data.var1[first];
+         var2 = data.var2[first];
+         sum += reader->EvaluateMVA( mva, aux );
+      } );
+      report( "reader", 1, l, sum );
+
+      // Native evaluator (as analysis --native) and tabulated response (as
+      // analysis --grid), timed per batch
+      enum { kNone, kKNN, kBDT, kMLP, kSVM } kind = kNone;
+      NativeKNN<2> knn;
+      FlatForest   bdt;
+      NativeMLP    mlp;
+      NativeSVM    svm;
+      {
+         TMVAWeightsFile wf;
+         std::string type;
+         if (wf.Open( weightfile )) type = wf.Method().substr( 0, wf.Method().find( "::" ) );
+         if      (type == "KNN" && knn.LoadXML( weightfile )) kind = kKNN;
+         else if (type == "BDT" && bdt.LoadXML( weightfile )) kind = kBDT;
+         else if (type == "MLP" && mlp.LoadXML( weightfile )) kind = kMLP;
+         else if (type == "SVM" && svm.LoadXML( weightfile )) kind = kSVM;
+      }
+
+      ResponseGrid grid;
+      std::string gridfile = "dataset/weights/classification_" + method + ".grid";
+      struct stat gst;
+      bool hasGrid = stat( gridfile.c_str(), &gst ) == 0 && grid.LoadBinary( gridfile );
+
+      NativeKNN<2>::Workspace knnWs;
+      NativeMLP::Workspace    mlpWs;
+      NativeSVM::Workspace    svmWs;
+      std::vector<float>  out( batchSizes[nBatchSizes - 1] );
+      std::vector<double> bdtOut( out.size() );
+
+      for (int useGrid = 0; useGrid < 2; useGrid++) {
+         if (useGrid ? !hasGrid : kind == kNone) continue;
+
+         for (size_t b = 0; b < nBatchSizes; b++) {
+            sum = 0;
+            l = TimeCalls( data.size(), batchSizes[b], [&]( size_t first, size_t n ) {
+               const float *x[2] = { &data.var1[first], &data.var2[first] };
+               if (useGrid) {
+                  grid.EvaluateBatch( n, x, &out[0] );
+               } else {
+                  switch (kind) {
+                     case kKNN: knn.EvaluateBatch( n, x, &out[0], knnWs ); break;
+                     case kBDT: bdt.EvaluateBatch( n, x, &bdtOut[0] ); out[0] = bdtOut[0]; break;
+                     case kMLP: mlp.EvaluateBatch( n, x, &out[0], mlpWs ); break;
+                     case kSVM: svm.EvaluateBatch( n, x, &out[0], svmWs ); break;
+                     case kNone: break;
+                  }
+               }
+               sum += out[0];
+            } );
+            report( useGrid ? "grid" : "native", batchSizes[b], l, sum );
+         }
+      }
+
+      if (cost.measured)
+         std::cout << "==>   training " << cost.wallTime << " s wall, " << cost.cpuTime << " s CPU, peak RSS "
+                   << cost.peakRSS << " MB, weight file " << st.st_size << " bytes" << std::endl;
+
+      delete reader;
+   }
+
+   fclose( csv );
+   std::cout << "==> Wrote benchmark.csv" << std::endl;
+   return 0;
+}
@@ -0,0 +1,242 @@
+/// Compact binary model files for the native evaluators
+///
+/// A model file holds the ready-to-use arrays of one trained method (e.g. the
+/// k-d tree of NativeKNN or the flat forest of FlatForest), so that loading
+/// it is a memory map and a few copies instead of parsing the XML weight
+/// file and rebuilding the classifier. Layout (native byte order):
+///
+///    header    "TMVABIN1", model type, number of variables, number of sections
+///    sections  nSections x { id, element size, offset, number of elements }
+///    data      the arrays, each at a 64-byte aligned offset
+///
+/// The evaluators write their arrays with BinaryModelWriter and read them
+/// back from a BinaryModel:
+///
+///    BinaryModelWriter out( BinaryModel::kKNN, 2 );
+///    out.Add( 1, fPoints );  ...  out.Write( "classification_KNN.model" );
+///
+///    BinaryModel in;
+///    in.Open( "classification_KNN.model" );
+///    in.Get( 1, fPoints );
+///
+/// model_export.cpp writes the model files of the trained methods next to
+/// their weight files: dataset/weights/classification_<Method>.model
+
+#ifndef BINARY_MODEL_H
+#define BINARY_MODEL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+struct BinaryModelHeader {
+   char     magic[8];    // "TMVABIN1"
+   uint32_t type;        // BinaryModel::EType
+   uint32_t nVar;
+   uint32_t nSections;
+   uint32_t reserved;
+};
+
+struct BinaryModelSection {
+   uint32_t id;
+   uint32_t elemSize;
+   uint64_t offset;      // from the start of the file
+   uint64_t count;
+};
+
+// ==============================================================================
+
+class BinaryModelWriter {
+
+public:
+
+   BinaryModelWriter( uint32_t type, uint32_t nVar ) : fType( type ), fNVar( nVar ) {}
+
+   template <typename T>
+   void Add( uint32_t id, const std::vector<T>& values )
+   {
+      Add( id, sizeof(T), values.size(), values.empty() ? 0 : &values[0] );
+   }
+
+   void Add( uint32_t id, uint32_t elemSize, uint64_t count, const void* data )
+   {
+      BinaryModelSection section = { id, elemSize, 0, count };
+      fSections.push_back( section );
+      const char *bytes = (const char*) data;
+      fData.push_back( std::vector<char>( bytes, bytes + elemSize * count ) );
+   }
+
+   // written under a temporary name and renamed, so that readers never map
+   // a partial file
+   bool Write( const std::string& fileName )
+   {
+      BinaryModelHeader header;
+      memcpy( header.magic, "TMVABIN1", 8 );
+      header.type      = fType;
+      header.nVar      = fNVar;
+      header.nSections = fSections.size();
+      header.reserved  = 0;
+
+      uint64_t offset = sizeof(header) + fSections.size() * sizeof(BinaryModelSection);
+      for (size_t i = 0; i < fSections.size(); i++) {
+         offset = Align( offset );
+         fSections[i].offset = offset;
+         offset += fData[i].size();
+      }
+
+      std::string tmpName = fileName + ".tmp";
+      FILE *out = fopen( tmpName.c_str(), "wb" );
+      if (!out) {
+         std::cout << "==> ERROR: cannot write " << tmpName << std::endl;
+         return false;
+      }
+
+      bool ok = fwrite( &header, sizeof(header), 1, out ) == 1;
+      if (!fSections.empty())
+         ok = ok && fwrite( &fSections[0], sizeof(BinaryModelSection), fSections.size(), out ) == fSections.size();
+
+      uint64_t pos = sizeof(header) + fSections.size() * sizeof(BinaryModelSection);
+      static const char zeros[64] = { 0 };
+      for (size_t i = 0; i < fSections.size() && ok; i++) {
+         ok = fwrite( zeros, 1, fSections[i].offset - pos, out ) == fSections[i].offset - pos;
+         if (!fData[i].empty()) ok = ok && fwrite( &fData[i][0], 1, fData[i].size(), out ) == fData[i].size();
+         pos = fSections[i].offset + fData[i].size();
+      }
+
+      ok = (fclose( out ) == 0) && ok;
+      if (!ok || rename( tmpName.c_str(), fileName.c_str() ) != 0) {
+         std::cout << "==> ERROR: cannot write " << fileName << std::endl;
+         remove( tmpName.c_str() );
+         return false;
+      }
+
+      std::cout << "==> Wrote " << fileName << " (" << pos << " bytes)" << std::endl;
+      return true;
+   }
+
+   static uint64_t Align( uint64_t offset ) { return (offset + 63) & ~uint64_t( 63 ); }
+
+private:
+
+   uint32_t                          fType;
+   uint32_t                          fNVar;
+   std::vector<BinaryModelSection>   fSections;
+   std::vector< std::vector<char> >  fData;
+
+};
+
+// ==============================================================================
+
+class BinaryModel {
+
+public:
+
+   enum EType { kKNN = 1, kBDT = 2, kMLP = 3, kSVM = 4, kGrid = 5 };
+
+   BinaryModel() : fData( 0 ), fSize( 0 ) {}
+   ~BinaryModel() { Close(); }
+
+   bool Open( const std::string& fileName )
+   {
+      Close();
+      fFileName = fileName;
+
+      int fd = open( fileName.c_str(), O_RDONLY );
+      struct stat st;
+      if (fd < 0 || fstat( fd, &st ) != 0 || (size_t) st.st_size < sizeof(BinaryModelHeader)) {
+         std::cout << "==> ERROR: cannot open model file " << fileName << std::endl;
+         if (fd >= 0) close( fd );
+         return false;
+      }
+      fSize = st.st_size;
+      void *data = mmap( 0, fSize, PROT_READ, MAP_PRIVATE, fd, 0 );
+      close( fd );
+      if (data == MAP_FAILED) {
+         std::cout << "==> ERROR: cannot map model file " << fileName << std::endl;
+         fSize = 0;
+         return false;
+      }
+      fData = (const char*) data;
+
+      const BinaryModelHeader *header = Header();
+      if (memcmp( header->magic, "TMVABIN1", 8 ) != 0 ||
+          sizeof(BinaryModelHeader) + header->nSections * sizeof(BinaryModelSection) > fSize) {
+         std::cout << "==> ERROR: " << fileName << " is not a model file" << std::endl;
+         Close();
+         return false;
+      }
+      for (uint32_t i = 0; i < header->nSections; i++) {
+         const BinaryModelSection &s = Sections()[i];
+         // no overflow for any count read from a corrupt file
+         if (s.offset > fSize || s.elemSize == 0 || s.count > (fSize - s.offset) / s.elemSize) {
+            std::cout << "==> ERROR: " << fileName << " is truncated" << std::endl;
+            Close();
+            return false;
+         }
+      }
+      return true;
+   }
+
+   void Close()
+   {
+      if (fData) munmap( (void*) fData, fSize );
+      fData = 0;
+      fSize = 0;
+   }
+
+   const std::string& FileName() const { return fFileName; }
+
+   uint32_t Type() const { return Header()->type; }
+   uint32_t NVar() const { return Header()->nVar; }
+
+   // mapped array of section id (0 if missing or of another element type)
+   template <typename T>
+   const T* Data( uint32_t id, uint64_t& count ) const
+   {
+      const BinaryModelSection *s = Find( id );
+      if (!s || s->elemSize != sizeof(T)) return 0;
+      count = s->count;
+      return (const T*) (fData + s->offset);
+   }
+
+   // copy of section id
+   template <typename T>
+   bool Get( uint32_t id, std::vector<T>& values ) const
+   {
+      uint64_t count = 0;
+      const T *data = Data<T>( id, count );
+      if (!data) {
+         std::cout << "==> ERROR: " << fFileName << ": no section " << id << std::endl;
+         return false;
+      }
+      values.assign( data, data + count );
+      return true;
+   }
+
+private:
+
+   const char  *fData;
+   size_t       fSize;
+   std::string  fFileName;
+
+   const BinaryModelHeader*  Header()   const { return (const BinaryModelHeader*) fData; }
+   const BinaryModelSection* Sections() const { return (const BinaryModelSection*) (fData + sizeof(BinaryModelHeader)); }
+
+   const BinaryModelSection* Find( uint32_t id ) const
+   {
+      for (uint32_t i = 0; i < Header()->nSections; i++)
+         if (Sections()[i].id == id) return &Sections()[i];
+      return 0;
+   }
+
+};
+
+#endif
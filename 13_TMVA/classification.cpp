@@ -16,6 +16,16 @@
 /// //-----> MPPE <------  running the example 
 /// ./classification KNN Cuts PDERS BDT
 ///
+/// The booked methods can be trained concurrently, each one in its own
+/// worker process, with at most N processes at a time:
+///
+/// ./classification -j 8 KNN Cuts PDERS BDT
+///
+/// The weight files are the same as for the serial training; the training
+/// monitoring histograms of each method go to TMVA_<Method>.root and its log
+/// to TMVA_<Method>.log, the test and evaluation of all methods to TMVA.root
+/// as usual.
+///
 /// If no method given, a default set is of classifiers is used
 /// (all methods that are turned on):
 /// For example:
@@ -30,15 +40,33 @@
 /// The program also produces
 /// dataset/weights directory with results from training 
 ///
+/// The input text files are converted on the first run into a binary
+/// cache (<sample dir>/.cache/*.root, see input_cache.h) that is used
+/// by all later runs as long as the text files do not change
+///
+/// With --stream the training and test events are not selected by the
+/// DataLoader from the full trees in memory, but sampled at random while
+/// streaming through the cached trees (see stream_input.h): the memory
+/// needed depends on the numbers of training and test events only, not on
+/// the size of the samples.
+///
+/// ./classification --stream BDT
+///
 /// - Project   : TMVA - a ROOT-integrated toolkit for multivariate data analysis
 /// - Package   : TMVA
 ///
 /// Based on official TMVA example by Andreas Hoecker
 
 #include <cstdlib>
+#include <cstdio>
 #include <iostream>
 #include <map>
 #include <string>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #include "TChain.h"
 #include "TFile.h"
@@ -50,10 +78,89 @@
 
 #include "TMVA/Factory.h"
 #include "TMVA/DataLoader.h"
+#include "TMVA/MethodBase.h"
+#include "TMVA/Event.h"
 #include "TMVA/Tools.h"
 #include "TMVA/TMVAGui.h"
 
-int classification( TString myMethodList = "" )
+#include "input_cache.h"
+#include "stream_input.h"
+
+// Train every selected method in its own worker process, at most nJobs at a
+// time. A worker runs this program as "classification --train-only <Method>":
+// same job and DataLoader names, hence the usual weight file
+// dataset/weights/classification_<Method>.weights.xml.
+bool TrainInWorkers( const std::map<std::string,int>& Use, int nJobs, bool streamInput )
+{
+   std::vector<std::string> queue;
+   for (std::map<std::string,int>::const_iterator it = Use.begin(); it != Use.end(); it++)
+      if (it->second) queue.push_back(it->first);
+
+   std::map<pid_t,std::string> running;
+   size_t next = 0;
+   bool ok = true;
+
+   while (next < queue.size() || !running.empty()) {
+
+      // start workers while there are free slots
+      while (ok && next < queue.size() && (int)running.size() < nJobs) {
+         pid_t pid = fork();
+         if (pid == 0) {
+            // worker output goes to TMVA_<Method>.log
+            std::string logName = "TMVA_" + queue[next] + ".log";
+            if (!freopen( logName.c_str(), "w", stdout ) || !freopen( logName.c_str(), "a", stderr )) _exit( 127 );
+            execl( "/proc/self/exe", "classification", "--train-only", queue[next].c_str(),
+                   streamInput ? "--stream" : (char*)0, (char*)0 );
+            perror( "execl" );
+            _exit( 127 );
+         }
+         if (pid < 0) {
+            perror( "fork" );
+            ok = false;
+            break;
+         }
+         std::cout << "==> Training " << queue[next] << " in worker process " << pid << std::endl;
+         running[pid] = queue[next++];
+      }
+
+      if (running.empty()) break;
+
+      int status = 0;
+      pid_t pid = wait( &status );
+      if (pid < 0) break;
+
+      if (WIFEXITED(status) && WEXITSTATUS(status) == 0) {
+         std::cout << "==> Training of " << running[pid] << " done" << std::endl;
+      } else {
+         std::cout << "==> ERROR: training of " << running[pid] << " failed" << std::endl;
+         ok = false;
+      }
+      running.erase( pid );
+   }
+
+   return ok;
+}
+
+// Load the methods trained by the workers from their weight files, in place of
+// Factory::TrainAllMethods, and add their response on the training sample
+// (needed by EvaluateAllMethods for the overtraining check)
+void LoadTrainedMethods( TMVA::Factory* factory, TMVA::DataLoader* dataloader, const std::map<std::string,int>& Use )
+{
+   for (std::map<std::string,int>::const_iterator it = Use.begin(); it != Use.end(); it++) {
+      if (!it->second) continue;
+
+      TMVA::MethodBase *method = dynamic_cast<TMVA::MethodBase*>( factory->GetMethod( dataloader->GetName(), it->first ) );
+      if (!method) continue; // selected but not booked (e.g. DNN without CPU/GPU support)
+
+      TMVA::Event::SetIsTraining( kTRUE );
+      method->ReadStateFromFile();
+      method->AddOutput( TMVA::Types::kTraining, TMVA::Types::kClassification );
+      TMVA::Event::SetIsTraining( kFALSE );
+   }
+}
+
+int classification( TString myMethodList = "", int nJobs = 1, bool trainOnly = false, bool streamInput = false,
+                    bool listOnly = false )
 {
 
   
@@ -134,9 +241,6 @@ int classification( TString myMethodList = "" )
    Use["RuleFit"]         = 1;
    // ---------------------------------------------------------------
 
-   std::cout << std::endl;
-   std::cout << "==> Start TMVA classification" << std::endl;
-
    // Select methods (don't look at this code - not of interest)
    if (myMethodList != "") {
       for (std::map<std::string,int>::iterator it = Use.begin(); it != Use.end(); it++) it->second = 0;
@@ -155,6 +259,16 @@ int classification( TString myMethodList = "" )
       }
    }
 
+   // --list: only print the selected methods, one per line (used by benchmark.cpp)
+   if (listOnly) {
+      for (std::map<std::string,int>::iterator it = Use.begin(); it != Use.end(); it++)
+         if (it->second) std::cout << it->first << std::endl;
+      return 0;
+   }
+
+   std::cout << std::endl;
+   std::cout << "==> Start TMVA classification" << std::endl;
+
    // --------------------------------------------------------------------------------------------------
 
    // Here the preparation phase begins
@@ -165,7 +279,9 @@ int classification( TString myMethodList = "" )
    //TTree *background     = (TTree*)input->Get("TreeB");
 
    // Create a ROOT output file where TMVA will store ntuples, histograms, etc.
+   // (a worker training a single method writes to TMVA_<Method>.root)
    TString outfileName( "TMVA.root" );
+   if (trainOnly) outfileName = "TMVA_" + myMethodList + ".root";
    TFile* outputFile = TFile::Open( outfileName, "RECREATE" );
 
    // Create the factory object. Later you can choose the methods
@@ -197,8 +313,20 @@ int classification( TString myMethodList = "" )
    // global event weights per tree (see below for setting event-wise weights)
    Double_t signalWeight     = 1.0;
    Double_t backgroundWeight = 1.0;
-   
-   dataloader->SetInputTrees(sigFile,bkgFile,signalWeight,backgroundWeight);
+
+   // The text files are converted once into a binary cache (<dir>/.cache/*.root,
+   // see input_cache.h); later runs read the cached trees directly
+   //dataloader->SetInputTrees(sigFile,bkgFile,signalWeight,backgroundWeight);
+   TFile *sigCache = 0;
+   TFile *bkgCache = 0;
+   if (!streamInput) {
+      TTree *sigTree  = GetCachedTree( sigFile, sigCache );
+      TTree *bkgTree  = GetCachedTree( bkgFile, bkgCache );
+      if (!sigTree || !bkgTree) return 1;
+
+      dataloader->AddSignalTree    ( sigTree, signalWeight );
+      dataloader->AddBackgroundTree( bkgTree, backgroundWeight );
+   }
    
    // Define the input variables that shall be used for the MVA training
    // note that you may also use variable expressions, such as: "3*var1/var2*abs(var3)"
@@ -226,8 +354,45 @@ int classification( TString myMethodList = "" )
    //
 
    //-----> MPPE <------  setting number of training and test samples   
-   dataloader->PrepareTrainingAndTestTree( mycuts, mycutb,
-                                        "nTrain_Signal=15000:nTrain_Background=15000:nTest_Signal=5000:nTest_Background=5000:SplitMode=Random:NormMode=NumEvents:!V" );
+   if (!streamInput) {
+      dataloader->PrepareTrainingAndTestTree( mycuts, mycutb,
+                                           "nTrain_Signal=15000:nTrain_Background=15000:nTest_Signal=5000:nTest_Background=5000:SplitMode=Random:NormMode=NumEvents:!V" );
+   } else {
+      // Streamed input: the same numbers of events, drawn at random (seeded,
+      // hence the same in all worker processes) in one pass over each sample.
+      // The preselection cuts are not applied in this mode.
+      const size_t nTrain = 15000, nTest = 5000;
+      std::vector<double> values( 2 );
+      for (int isSignal = 1; isSignal >= 0; isSignal--) {
+         EventStream stream;
+         if (!stream.Open( isSignal ? sigFile : bkgFile )) return 1;
+
+         EventReservoir train, test;
+         RandomSplit( stream, nTrain, nTest, isSignal ? 1001 : 1002, train, test );
+         std::cout << "==> Sampled " << train.size() << " training and " << test.size() << " test events of "
+                   << stream.GetEntries() << " " << (isSignal ? "signal" : "background") << " events" << std::endl;
+
+         Double_t weight = isSignal ? signalWeight : backgroundWeight;
+         for (size_t i = 0; i < train.size(); i++) {
+            values[0] = train.var1[i];
+            values[1] = train.var2[i];
+            if (isSignal) dataloader->AddSignalTrainingEvent( values, weight );
+            else          dataloader->AddBackgroundTrainingEvent( values, weight );
+         }
+         for (size_t i = 0; i < test.size(); i++) {
+            values[0] = test.var1[i];
+            values[1] = test.var2[i];
+            if (isSignal) dataloader->AddSignalTestEvent( values, weight );
+            else          dataloader->AddBackgroundTestEvent( values, weight );
+         }
+      }
+      dataloader->PrepareTrainingAndTestTree( "", "NormMode=NumEvents:!V" );
+   }
+
+   // Concurrent training: the workers are started here, when the input cache
+   // exists. They all use the same (seeded) random split of the events.
+   bool trainInWorkers = (nJobs > 1 && !trainOnly);
+   if (trainInWorkers && !TrainInWorkers( Use, nJobs, streamInput )) return 1;
 
    // ### Book MVA methods
    //
@@ -439,7 +604,18 @@ int classification( TString myMethodList = "" )
    // Now you can tell the factory to train, test, and evaluate the MVAs
    //
    // Train MVAs using the set of training events
-   factory->TrainAllMethods();
+   // (or take them from the weight files written by the workers)
+   if (trainInWorkers) LoadTrainedMethods( factory, dataloader, Use );
+   else                factory->TrainAllMethods();
+
+   if (trainOnly) {
+      outputFile->Close();
+      if (sigCache) sigCache->Close();
+      if (bkgCache) bkgCache->Close();
+      delete factory;
+      delete dataloader;
+      return 0;
+   }
 
    // Evaluate all MVAs using the set of test events
    factory->TestAllMethods();
@@ -451,6 +627,8 @@ int classification( TString myMethodList = "" )
 
    // Save the output
    outputFile->Close();
+   if (sigCache) sigCache->Close();
+   if (bkgCache) bkgCache->Close();
 
    std::cout << "==> Wrote root file: " << outputFile->GetName() << std::endl;
    std::cout << "==> TMVA classification is done!" << std::endl;
@@ -467,11 +645,19 @@ int main( int argc, char** argv )
 {
    // Select methods (don't look at this code - not of interest)
    TString methodList;
+   int nJobs = 1;
+   bool trainOnly = false;
+   bool streamInput = false;
+   bool listOnly = false;
    for (int i=1; i<argc; i++) {
       TString regMethod(argv[i]);
       if(regMethod=="-b" || regMethod=="--batch") continue;
+      if((regMethod=="-j" || regMethod=="--jobs") && i+1<argc) { nJobs = atoi(argv[++i]); continue; }
+      if(regMethod=="--train-only") { trainOnly = true; continue; }
+      if(regMethod=="--stream") { streamInput = true; continue; }
+      if(regMethod=="--list") { listOnly = true; continue; }
       if (!methodList.IsNull()) methodList += TString(",");
       methodList += regMethod;
    }
-   return classification(methodList);
+   return classification(methodList, nJobs, trainOnly, streamInput, listOnly);
 }
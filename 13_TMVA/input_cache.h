@@ -0,0 +1,113 @@
+/// Binary cache of the ASCII input samples used for training
+///
+/// The text files (e.g. sample_good_separation/signal.txt, with a
+/// "var1/F:var2/F" header line) are converted once into a compressed
+/// columnar TTree stored in
+///
+///    <sample dir>/.cache/<file name>_<md5 of the file>.root
+///
+/// Later runs open the cached tree directly instead of re-parsing the text.
+/// Because the key is the checksum of the file content, an edited or
+/// regenerated text file gets a new cache entry automatically.
+///
+/// Usage:
+///
+///    TFile *cache = 0;
+///    TTree *tree = GetCachedTree("sample_good_separation/signal.txt", cache);
+///    dataloader->AddSignalTree(tree, 1.0);
+///    ...                        // cache must stay open while TMVA reads the tree
+///    cache->Close();
+
+#ifndef INPUT_CACHE_H
+#define INPUT_CACHE_H
+
+#include <iostream>
+#include <string>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TMD5.h"
+#include "TString.h"
+#include "TSystem.h"
+#include "Compression.h"
+
+// Name of the tree in the cache files
+const char* const kCachedTreeName = "InputTree";
+
+// Name of the cache file of txtFile: <dir>/.cache/<name>_<md5>.root
+inline std::string CachedTreeFileName( const std::string& txtFile )
+{
+   TMD5 *md5 = TMD5::FileChecksum( txtFile.c_str() );
+   if (!md5) return "";
+
+   std::string dir  = gSystem->GetDirName( txtFile.c_str() ).Data();
+   std::string name = gSystem->BaseName( txtFile.c_str() );
+   std::string key  = md5->AsString();
+   delete md5;
+
+   return dir + "/.cache/" + name + "_" + key + ".root";
+}
+
+// Tree with the content of txtFile, read from (or first written to) the
+// binary cache. The returned tree belongs to cacheFile, which is left open.
+// Returns 0 if the text file cannot be read.
+inline TTree* GetCachedTree( const std::string& txtFile, TFile*& cacheFile )
+{
+   cacheFile = 0;
+
+   std::string cacheName = CachedTreeFileName( txtFile );
+   if (cacheName == "") {
+      std::cout << "==> ERROR: cannot read input file " << txtFile << std::endl;
+      return 0;
+   }
+
+   if (gSystem->AccessPathName( cacheName.c_str() )) {
+
+      // Not cached yet: convert the text file. Written under a temporary name
+      // and renamed at the end, so that concurrent jobs never see a partial file.
+      gSystem->mkdir( gSystem->GetDirName( cacheName.c_str() ), kTRUE );
+
+      std::string tmpName = cacheName + Form( ".tmp%d", gSystem->GetPid() );
+
+      // LZ4: fast decompression, which is what matters for repeated training
+      TFile *out = TFile::Open( tmpName.c_str(), "RECREATE", "", ROOT::CompressionSettings( ROOT::kLZ4, 4 ) );
+      if (!out || out->IsZombie()) {
+         std::cout << "==> ERROR: cannot create cache file " << tmpName << std::endl;
+         return 0;
+      }
+
+      TTree *tree = new TTree( kCachedTreeName, txtFile.c_str() );
+      Long64_t nEvents = tree->ReadFile( txtFile.c_str() ); // branches from the "var1/F:var2/F" header
+      tree->Write();
+      out->Close();
+      delete out;
+
+      if (nEvents <= 0) {
+         std::cout << "==> ERROR: no events in input file " << txtFile << std::endl;
+         gSystem->Unlink( tmpName.c_str() );
+         return 0;
+      }
+
+      gSystem->Rename( tmpName.c_str(), cacheName.c_str() );
+
+      std::cout << "==> Cached " << nEvents << " events of " << txtFile << " in " << cacheName << std::endl;
+   }
+
+   cacheFile = TFile::Open( cacheName.c_str(), "READ" );
+   if (!cacheFile || cacheFile->IsZombie()) {
+      std::cout << "==> ERROR: cannot open cache file " << cacheName << std::endl;
+      return 0;
+   }
+
+   TTree *tree = (TTree*)cacheFile->Get( kCachedTreeName );
+   if (!tree) {
+      std::cout << "==> ERROR: no tree " << kCachedTreeName << " in cache file " << cacheName << std::endl;
+      return 0;
+   }
+
+   std::cout << "==> Using cached input " << cacheName << " (" << tree->GetEntries() << " events)" << std::endl;
+
+   return tree;
+}
+
+#endif
@@ -0,0 +1,97 @@
+/// Check of the native KNN classifier (knn_native.h) against TMVA
+///
+/// Evaluates the KNN method trained by classification.cpp on the events of
+/// a data file, with TMVA::Reader and with NativeKNN, and prints the largest
+/// difference of the responses and the time per event of both.
+///
+///     make -f Makefile_knn_native
+///     ./knn_native [data file] [number of events compared]
+///
+/// The defaults are sample_good_separation/data.txt and 10000 events (the
+/// TMVA evaluation is the slow one).
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <TString.h>
+#include <TStopwatch.h>
+
+#include <TMVA/Reader.h>
+#include <TMVA/MethodBase.h>
+
+#include "batch_eval.h"
+#include "knn_native.h"
+
+int main( int argc, char** argv )
+{
+   std::string dataFile = (argc > 1) ? argv[1] : "sample_good_separation/data.txt";
+   size_t      nCompare = (argc > 2) ? atol( argv[2] ) : 10000;
+
+   TString weightfile = "dataset/weights/classification_KNN.weights.xml";
+
+   EventData data;
+   if (!LoadEventData( dataFile, data )) return 1;
+   nCompare = std::min( nCompare, data.size() );
+
+   TStopwatch timer;
+
+   // --- TMVA
+   Float_t var1, var2;
+   TMVA::Reader *reader = new TMVA::Reader( "!Color:Silent" );
+   reader->AddVariable( "var1", &var1 );
+   reader->AddVariable( "var2", &var2 );
+
+   timer.Start();
+   TMVA::MethodBase *method = dynamic_cast<TMVA::MethodBase*>( reader->BookMVA( "KNN method", weightfile ) );
+   timer.Stop();
+   if (!method) {
+      std::cout << "==> ERROR: cannot book KNN from " << weightfile << std::endl;
+      return 1;
+   }
+   double tmvaLoad = timer.RealTime();
+
+   std::vector<float> tmvaOut( nCompare );
+   timer.Start();
+   for (size_t i = 0; i < nCompare; i++) {
+      var1 = data.var1[i];
+      var2 = data.var2[i];
+      tmvaOut[i] = reader->EvaluateMVA( method );
+   }
+   timer.Stop();
+   double tmvaTime = timer.RealTime() / nCompare;
+
+   // --- native
+   NativeKNN<2> knn;
+   timer.Start();
+   if (!knn.LoadXML( weightfile.Data() )) return 1;
+   timer.Stop();
+   double nativeLoad = timer.RealTime();
+
+   std::vector<float> nativeOut( data.size() );
+   NativeKNN<2>::Workspace ws;
+   const float *x[2] = { &data.var1[0], &data.var2[0] };
+   timer.Start();
+   knn.EvaluateBatch( data.size(), x, &nativeOut[0], ws );
+   timer.Stop();
+   double nativeTime = timer.RealTime() / data.size();
+
+   // --- comparison
+   double maxDiff = 0;
+   size_t nDiff   = 0;
+   for (size_t i = 0; i < nCompare; i++) {
+      double diff = fabs( tmvaOut[i] - nativeOut[i] );
+      maxDiff = std::max( maxDiff, diff );
+      if (diff > 1e-6) nDiff++;
+   }
+
+   std::cout << "==> Compared " << nCompare << " events: " << nDiff << " differ, max |difference| = " << maxDiff << std::endl;
+   std::cout << "==> Loading:  TMVA " << tmvaLoad << " s, native " << nativeLoad << " s" << std::endl;
+   std::cout << "==> Per event: TMVA " << tmvaTime * 1e6 << " us, native " << nativeTime * 1e6 << " us"
+             << " (x" << tmvaTime / std::max( nativeTime, 1e-12 ) << ")" << std::endl;
+
+   delete reader;
+   return nDiff == 0 ? 0 : 1;
+}
@@ -0,0 +1,412 @@
+/// Native k-nearest-neighbour classifier, equivalent to the TMVA KNN method
+///
+/// Rebuilds the KNN classifier booked in classification.cpp from its weight
+/// file (which stores the whole training sample) and evaluates it without
+/// TMVA. The number of input variables is a template parameter, so the
+/// distance computation is fully unrolled:
+///
+///    NativeKNN<2> knn;
+///    knn.LoadXML( "dataset/weights/classification_KNN.weights.xml" );
+///    NativeKNN<2>::Workspace ws;                     // one per thread
+///    float x[2] = { var1, var2 };
+///    double response = knn.Evaluate( x, ws );
+///
+/// The response is the one of TMVA::MethodKNN::GetMvaValue with
+/// UseKernel=F and UseLDA=F (the options used here):
+///
+///  - every variable is divided by the width of the central ScaleFrac
+///    fraction of its training distribution, with the integer percentiles
+///    of TMVA::kNN::ModulekNN::ComputeMetric;
+///  - the nkNN+2 nearest training events are found (squared Euclidean
+///    distance in single precision, as kNN::Event::GetDist) and the first
+///    nkNN of them are used, including those at zero distance;
+///  - response = sum of signal weights / sum of all weights of those nkNN
+///    events (unit weights if UseWeight=F), -100 if it cannot be computed.
+///
+/// The search is exact. The training events are stored in a flattened k-d
+/// tree: the points are reordered so that every leaf (at most kLeafSize
+/// points) is contiguous, and the split planes of the internal nodes are
+/// kept in a heap-ordered array (children of node i are 2i+1 and 2i+2), so
+/// no pointers are followed. Each query keeps its nkNN+2 best candidates in a
+/// bounded max-heap held by the caller's Workspace: no allocation per event.
+///
+/// WriteBinary/LoadBinary save and restore the built tree as a binary model
+/// file (binary_model.h), which loads much faster than the XML weight file.
+
+#ifndef KNN_NATIVE_H
+#define KNN_NATIVE_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "tmva_weights.h"
+#include "binary_model.h"
+
+template <int NVAR>
+class NativeKNN {
+
+public:
+
+   static const int kLeafSize = 8;   // max. training events per leaf
+
+   // per-thread search state
+   struct Workspace {
+      std::vector< std::pair<float,uint32_t> > fHeap; // (distance^2, event), max-heap
+   };
+
+   NativeKNN() : fnkNN( 20 ), fScaleFrac( 0.8 ), fUseWeight( true ), fNInternal( 0 ) {}
+
+   // ---------------------------------------------------------------------------
+
+   // classifier from the TMVA weight file
+   bool LoadXML( const std::string& fileName )
+   {
+      TMVAWeightsFile wf;
+      if (!wf.Open( fileName )) return false;
+
+      if (wf.Method().compare( 0, 5, "KNN::" ) != 0) {
+         std::cout << "==> ERROR: " << fileName << " is not a KNN weight file" << std::endl;
+         return false;
+      }
+      if ((int) wf.Variables().size() != NVAR) {
+         std::cout << "==> ERROR: " << fileName << " has " << wf.Variables().size()
+                   << " variables, NativeKNN<" << NVAR << "> expects " << NVAR << std::endl;
+         return false;
+      }
+      if (wf.OptionB( "UseKernel" ) || wf.OptionB( "UseLDA" ) || wf.OptionB( "Trim" )) {
+         std::cout << "==> ERROR: " << fileName << ": UseKernel, UseLDA and Trim are not supported" << std::endl;
+         return false;
+      }
+
+      fnkNN      = atoi( wf.Option( "nkNN" ).c_str() );
+      fScaleFrac = atof( wf.Option( "ScaleFrac" ).c_str() );
+      fUseWeight = wf.OptionB( "UseWeight" );
+
+      // training events: <Event Type="1|2" Weight="w">v1 v2 ...</Event>
+      std::vector<float>   x;
+      std::vector<uint8_t> type;
+      std::vector<double>  weight;
+      for (XMLNodePointer_t ev = wf.Child( wf.Child( wf.Root(), "Weights" ), "Event" ); ev; ev = wf.Next( ev, "Event" )) {
+         std::string values = wf.Content( ev );
+         const char *s = values.c_str();
+         for (int v = 0; v < NVAR; v++) {
+            char *end;
+            x.push_back( strtof( s, &end ) ); // read as float, as TMVA does
+            s = end;
+         }
+         type.push_back( wf.AttrI( ev, "Type" ) );
+         weight.push_back( wf.AttrD( ev, "Weight" ) );
+      }
+
+      return Build( x, type, weight );
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // classifier from the training events: x[i*NVAR + v], type 1 = signal,
+   // 2 = background (nkNN, ScaleFrac and UseWeight set before)
+   bool Build( const std::vector<float>& x, const std::vector<uint8_t>& type, const std::vector<double>& weight )
+   {
+      size_t nEvents = type.size();
+      if (nEvents < 100) {
+         std::cout << "==> ERROR: NativeKNN: " << nEvents << " training events, at least 100 needed" << std::endl;
+         return false;
+      }
+
+      // metric: width of the central ScaleFrac part of each variable
+      int ifrac = (int) (100.0 * fScaleFrac);
+      if (ifrac > 100) {
+         std::cout << "==> ERROR: NativeKNN: ScaleFrac=" << fScaleFrac << " is above 1" << std::endl;
+         return false;
+      }
+      for (int v = 0; v < NVAR; v++) {
+         fScale[v] = 1.0;
+         if (ifrac <= 0) continue;
+
+         std::vector<double> dvec( nEvents );
+         for (size_t i = 0; i < nEvents; i++) dvec[i] = x[i*NVAR + v];
+         std::sort( dvec.begin(), dvec.end() );
+
+         // TMVA's integer rule: the first events with (100*i)/N equal to the
+         // percentages lfrac and rfrac, the first and last events if none is
+         size_t lfrac = (100 - ifrac) / 2, rfrac = 100 - (100 - ifrac) / 2;
+         size_t lpos = nEvents, rpos = nEvents;
+         for (size_t i = 0; i < nEvents; i++) {
+            if ((100 * i) / nEvents == lfrac && lpos == nEvents) lpos = i;
+            if ((100 * i) / nEvents == rfrac && rpos == nEvents) rpos = i;
+         }
+         if (lpos == nEvents) lpos = 0;
+         if (rpos == nEvents) rpos = nEvents - 1;
+
+         fScale[v] = dvec[rpos] - dvec[lpos];
+         if (!(fScale[v] > 0.0)) {
+            std::cout << "==> ERROR: NativeKNN: variable " << v << " has zero width" << std::endl;
+            return false;
+         }
+      }
+
+      // scaled points, reordered into the tree below
+      std::vector< std::array<float,NVAR> > pts( nEvents );
+      std::vector<uint32_t> order( nEvents );
+      for (size_t i = 0; i < nEvents; i++) {
+         for (int v = 0; v < NVAR; v++) pts[i][v] = Scaled( x[i*NVAR + v], v );
+         order[i] = i;
+      }
+
+      // depth: every leaf gets at most kLeafSize points
+      int depth = 0;
+      while ((nEvents >> depth) > (size_t) kLeafSize) depth++;
+      fNInternal = (1u << depth) - 1;
+
+      fSplit.assign( fNInternal, 0.0f );
+      fSplitVar.assign( fNInternal, 0 );
+      fLeafStart.assign( fNInternal + 2, 0 );
+
+      BuildNode( 0, 0, nEvents, pts, order );
+
+      fPoints.resize( nEvents * NVAR );
+      fType.resize( nEvents );
+      fWeight.resize( nEvents );
+      for (size_t i = 0; i < nEvents; i++) {
+         for (int v = 0; v < NVAR; v++) fPoints[i*NVAR + v] = pts[order[i]][v];
+         fType[i]   = type[order[i]];
+         fWeight[i] = fUseWeight ? weight[order[i]] : 1.0;
+      }
+
+      std::cout << "==> NativeKNN: " << nEvents << " events, nkNN=" << fnkNN << ", "
+                << fNInternal + 1 << " leaves" << std::endl;
+      return true;
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // response for the event with input variables x[0..NVAR-1]
+   double Evaluate( const float* x, Workspace& ws ) const
+   {
+      float q[NVAR];
+      for (int v = 0; v < NVAR; v++) q[v] = Scaled( x[v], v );
+
+      size_t nFind = fnkNN + 2;
+      Search( q, nFind, ws );
+
+      std::vector< std::pair<float,uint32_t> > &heap = ws.fHeap;
+      if (heap.size() != nFind) return -100.0; // fewer training events than nkNN+2
+      std::sort_heap( heap.begin(), heap.end() );
+
+      double weightAll = 0.0, weightSig = 0.0;
+      int count = 0;
+      for (size_t j = 0; j < heap.size(); j++) {
+         uint32_t i = heap[j].second;
+         if (fType[i] == 1) weightSig += fWeight[i];
+         weightAll += fWeight[i];
+         if (++count >= fnkNN) break;
+      }
+
+      if (!(weightAll > 0.0)) return -100.0;
+      return weightSig / weightAll;
+   }
+
+   // responses of n events, variable v of event i in x[v][i]
+   void EvaluateBatch( size_t n, const float* const* x, float* response, Workspace& ws ) const
+   {
+      float xi[NVAR];
+      for (size_t i = 0; i < n; i++) {
+         for (int v = 0; v < NVAR; v++) xi[v] = x[v][i];
+         response[i] = Evaluate( xi, ws );
+      }
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // binary model file with the built tree
+   bool WriteBinary( const std::string& fileName ) const
+   {
+      std::vector<double> params;
+      params.push_back( fnkNN );
+      params.push_back( fScaleFrac );
+      params.push_back( fUseWeight );
+      params.push_back( fNInternal );
+      for (int v = 0; v < NVAR; v++) params.push_back( fScale[v] );
+
+      BinaryModelWriter out( BinaryModel::kKNN, NVAR );
+      out.Add( kParams,    params );
+      out.Add( kSplit,     fSplit );
+      out.Add( kSplitVar,  fSplitVar );
+      out.Add( kLeafStart, fLeafStart );
+      out.Add( kPoints,    fPoints );
+      out.Add( kType,      fType );
+      out.Add( kWeight,    fWeight );
+      return out.Write( fileName );
+   }
+
+   bool LoadBinary( const std::string& fileName )
+   {
+      BinaryModel in;
+      if (!in.Open( fileName )) return false;
+      if (in.Type() != BinaryModel::kKNN || in.NVar() != NVAR) {
+         std::cout << "==> ERROR: " << fileName << " is not a KNN model with " << NVAR << " variables" << std::endl;
+         return false;
+      }
+
+      std::vector<double> params;
+      if (!in.Get( kParams, params ) || params.size() != 4 + NVAR) return false;
+      // a complete tree of at most 2^31 leaves (Search's stack holds one
+      // pending node per level), nkNN >= 1 and positive scales
+      bool ok = params[0] >= 1 && params[0] <= 1e6 && params[3] >= 0 && params[3] < 2147483648.0;
+      if (ok) {
+         uint32_t nInternal = params[3];
+         ok = nInternal == params[3] && ((nInternal + 1) & nInternal) == 0;
+      }
+      for (int v = 0; v < NVAR; v++) ok = ok && params[4 + v] > 0.0;
+      if (!ok) {
+         std::cout << "==> ERROR: " << fileName << ": nkNN=" << params[0] << ", " << params[3]
+                   << " internal nodes" << std::endl;
+         return false;
+      }
+      fnkNN      = params[0];
+      fScaleFrac = params[1];
+      fUseWeight = params[2] != 0;
+      fNInternal = params[3];
+      for (int v = 0; v < NVAR; v++) fScale[v] = params[4 + v];
+
+      if (!in.Get( kSplit, fSplit ) || !in.Get( kSplitVar, fSplitVar ) || !in.Get( kLeafStart, fLeafStart ) ||
+          !in.Get( kPoints, fPoints ) || !in.Get( kType, fType ) || !in.Get( kWeight, fWeight )) return false;
+
+      if (fSplit.size() != fNInternal || fLeafStart.size() != fNInternal + 2 ||
+          fPoints.size() != fType.size() * NVAR || fWeight.size() != fType.size()) {
+         std::cout << "==> ERROR: " << fileName << ": inconsistent tree" << std::endl;
+         return false;
+      }
+      // both are used as indices by Search
+      for (size_t i = 0; i < fSplitVar.size(); i++) {
+         if (fSplitVar[i] >= NVAR) {
+            std::cout << "==> ERROR: " << fileName << ": node " << i << " splits on variable " << int(fSplitVar[i]) << std::endl;
+            return false;
+         }
+      }
+      bool ordered = fLeafStart.front() == 0 && fLeafStart.back() == fType.size();
+      for (size_t j = 0; j + 1 < fLeafStart.size(); j++) ordered = ordered && fLeafStart[j] <= fLeafStart[j + 1];
+      if (!ordered) {
+         std::cout << "==> ERROR: " << fileName << ": leaves do not partition the " << fType.size() << " events" << std::endl;
+         return false;
+      }
+      return true;
+   }
+
+   int    GetnkNN()      const { return fnkNN; }
+   double GetScaleFrac() const { return fScaleFrac; }
+   double GetScale( int v ) const { return fScale[v]; }
+   size_t GetNEvents()   const { return fType.size(); }
+
+private:
+
+   // sections of the binary model file
+   enum { kParams = 1, kSplit, kSplitVar, kLeafStart, kPoints, kType, kWeight };
+
+   int    fnkNN;
+   double fScaleFrac;
+   bool   fUseWeight;
+   double fScale[NVAR];
+
+   // tree: internal nodes in heap order, then the leaves
+   uint32_t              fNInternal;
+   std::vector<float>    fSplit;     // split value of internal node
+   std::vector<uint8_t>  fSplitVar;  // split variable of internal node
+   std::vector<uint32_t> fLeafStart; // leaf j holds points [fLeafStart[j], fLeafStart[j+1])
+
+   // training events in tree order
+   std::vector<float>    fPoints;    // scaled, fPoints[i*NVAR + v]
+   std::vector<uint8_t>  fType;
+   std::vector<double>   fWeight;
+
+   // x/scale, computed in double and stored in float as in kNN::ModulekNN::Scale
+   float Scaled( float x, int v ) const { return (float) (x / fScale[v]); }
+
+   // split [begin, end) at its median along the variable of largest spread
+   void BuildNode( uint32_t node, size_t begin, size_t end,
+                   const std::vector< std::array<float,NVAR> >& pts, std::vector<uint32_t>& order )
+   {
+      if (node >= fNInternal) {
+         uint32_t leaf = node - fNInternal;
+         fLeafStart[leaf]     = begin;
+         fLeafStart[leaf + 1] = end;
+         return;
+      }
+
+      int   var    = 0;
+      float spread = -1.0f;
+      for (int v = 0; v < NVAR; v++) {
+         float lo = pts[order[begin]][v], hi = lo;
+         for (size_t i = begin; i < end; i++) {
+            lo = std::min( lo, pts[order[i]][v] );
+            hi = std::max( hi, pts[order[i]][v] );
+         }
+         if (hi - lo > spread) { spread = hi - lo; var = v; }
+      }
+
+      size_t mid = begin + (end - begin) / 2;
+      std::nth_element( order.begin() + begin, order.begin() + mid, order.begin() + end,
+                        [&]( uint32_t a, uint32_t b ) { return pts[a][var] < pts[b][var]; } );
+
+      fSplit[node]    = pts[order[mid]][var];
+      fSplitVar[node] = var;
+
+      BuildNode( 2*node + 1, begin, mid, pts, order );
+      BuildNode( 2*node + 2, mid,   end, pts, order );
+   }
+
+   // the nFind nearest points to q in ws.fHeap (max-heap on distance)
+   void Search( const float* q, size_t nFind, Workspace& ws ) const
+   {
+      std::vector< std::pair<float,uint32_t> > &heap = ws.fHeap;
+      heap.clear();
+      heap.reserve( nFind );
+
+      // depth-first, near side first; the far side is visited only if the
+      // distance to its split plane can beat the current nFind-th candidate
+      struct Pending { uint32_t node; float bound; };
+      Pending stack[64];
+      int sp = 0;
+      stack[sp++] = Pending{ 0, 0.0f };
+
+      while (sp > 0) {
+         Pending p = stack[--sp];
+         if (heap.size() == nFind && p.bound >= heap.front().first) continue;
+
+         uint32_t node = p.node;
+         while (node < fNInternal) {
+            float diff = q[fSplitVar[node]] - fSplit[node];
+            uint32_t nearChild = 2*node + (diff < 0.0f ? 1 : 2);
+            uint32_t farChild  = 2*node + (diff < 0.0f ? 2 : 1);
+            stack[sp++] = Pending{ farChild, std::max( p.bound, diff*diff ) };
+            node = nearChild;
+         }
+
+         uint32_t leaf = node - fNInternal;
+         for (uint32_t i = fLeafStart[leaf]; i < fLeafStart[leaf + 1]; i++) {
+            const float *pt = &fPoints[i*NVAR];
+            float dist = 0.0f;
+            for (int v = 0; v < NVAR; v++) dist += (q[v] - pt[v]) * (q[v] - pt[v]);
+
+            if (heap.size() < nFind) {
+               heap.push_back( std::make_pair( dist, i ) );
+               std::push_heap( heap.begin(), heap.end() );
+            } else if (dist < heap.front().first) {
+               std::pop_heap( heap.begin(), heap.end() );
+               heap.back() = std::make_pair( dist, i );
+               std::push_heap( heap.begin(), heap.end() );
+            }
+         }
+      }
+   }
+
+};
+
+#endif
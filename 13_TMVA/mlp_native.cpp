@@ -0,0 +1,101 @@
+/// Check of the native MLP network (mlp_native.h) against TMVA
+///
+/// Evaluates an MLP method trained by classification.cpp (default MLPBNN) on
+/// the events of a data file, with TMVA::Reader and with NativeMLP, and
+/// prints the largest difference of the responses and the time per event of
+/// both, the native one on a single core.
+///
+///     make -f Makefile_mlp_native
+///     ./mlp_native [Method] [data file] [number of events compared]
+///
+/// The defaults are MLPBNN, sample_good_separation/data.txt and 100000 events.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <TString.h>
+#include <TStopwatch.h>
+
+#include <TMVA/Reader.h>
+#include <TMVA/MethodBase.h>
+
+#include "batch_eval.h"
+#include "mlp_native.h"
+
+int main( int argc, char** argv )
+{
+   TString     method   = (argc > 1) ? argv[1] : "MLPBNN";
+   std::string dataFile = (argc > 2) ? argv[2] : "sample_good_separation/data.txt";
+   size_t      nCompare = (argc > 3) ? atol( argv[3] ) : 100000;
+
+   TString weightfile = "dataset/weights/classification_" + method + ".weights.xml";
+
+   EventData data;
+   if (!LoadEventData( dataFile, data )) return 1;
+   nCompare = std::min( nCompare, data.size() );
+
+   TStopwatch timer;
+
+   // --- TMVA
+   Float_t var1, var2;
+   TMVA::Reader *reader = new TMVA::Reader( "!Color:Silent" );
+   reader->AddVariable( "var1", &var1 );
+   reader->AddVariable( "var2", &var2 );
+
+   timer.Start();
+   TMVA::MethodBase *mva = dynamic_cast<TMVA::MethodBase*>( reader->BookMVA( method + " method", weightfile ) );
+   timer.Stop();
+   if (!mva) {
+      std::cout << "==> ERROR: cannot book " << method << " from " << weightfile << std::endl;
+      return 1;
+   }
+   double tmvaLoad = timer.RealTime();
+
+   std::vector<float> tmvaOut( nCompare );
+   timer.Start();
+   for (size_t i = 0; i < nCompare; i++) {
+      var1 = data.var1[i];
+      var2 = data.var2[i];
+      tmvaOut[i] = reader->EvaluateMVA( mva );
+   }
+   timer.Stop();
+   double tmvaTime = timer.RealTime() / nCompare;
+
+   // --- native
+   NativeMLP mlp;
+   timer.Start();
+   if (!mlp.LoadXML( weightfile.Data() )) return 1;
+   timer.Stop();
+   double nativeLoad = timer.RealTime();
+
+   std::vector<float> nativeOut( data.size() );
+   NativeMLP::Workspace ws;
+   const float *x[2] = { &data.var1[0], &data.var2[0] };
+   timer.Start();
+   mlp.EvaluateBatch( data.size(), x, &nativeOut[0], ws );
+   timer.Stop();
+   double nativeTime = timer.RealTime() / data.size();
+
+   // --- comparison
+   // (single instead of double precision: differences up to kTolerance are expected)
+   const double kTolerance = 1e-5;
+   double maxDiff = 0;
+   size_t nDiff   = 0;
+   for (size_t i = 0; i < nCompare; i++) {
+      double diff = fabs( tmvaOut[i] - nativeOut[i] );
+      maxDiff = std::max( maxDiff, diff );
+      if (diff > kTolerance) nDiff++;
+   }
+
+   std::cout << "==> Compared " << nCompare << " events: " << nDiff << " differ, max |difference| = " << maxDiff << std::endl;
+   std::cout << "==> Loading:  TMVA " << tmvaLoad << " s, native " << nativeLoad << " s" << std::endl;
+   std::cout << "==> Per event: TMVA " << tmvaTime * 1e6 << " us, native " << nativeTime * 1e6 << " us"
+             << " (x" << tmvaTime / std::max( nativeTime, 1e-12 ) << ", "
+             << 1e-6 / std::max( nativeTime, 1e-12 ) << " million events/s)" << std::endl;
+
+   delete reader;
+   return nDiff == 0 ? 0 : 1;
+}
@@ -0,0 +1,300 @@
+/// Native batched evaluation of the TMVA MLP networks (MLP, MLPBFGS, MLPBNN)
+///
+/// Rebuilds the network from its weight file and evaluates blocks of events
+/// at once, instead of one event at a time through the TNeuron/TSynapse
+/// objects of TMVA::MethodMLP:
+///
+///    NativeMLP mlp;
+///    mlp.LoadXML( "dataset/weights/classification_MLPBNN.weights.xml" );
+///    NativeMLP::Workspace ws;                        // one per thread
+///    mlp.EvaluateBatch( n, x, response, ws );         // x[v][i], v = 0..NVar-1
+///
+/// The response is the one of TMVA::MethodANNBase::GetMvaValue:
+///
+///  - the inputs are normalized to [-1, 1] (VarTransform=N);
+///  - every layer but the output one has a bias neuron of value 1 (the last
+///    neuron of the layer in the weight file);
+///  - the hidden neurons have the activation of NeuronType (tanh or sigmoid;
+///    linear and radial are also supported), the output neuron a sigmoid
+///    (EstimatorType=CE, forced for classification) or the identity (MSE).
+///    tanh is the Pade approximation TMVA uses by default (PadeTanh in
+///    vec_math.h, saturating to +-1 for |x| > 4.97), not the exact tanh.
+///
+/// The synapse weights of layer l are stored as one row-major matrix
+/// W[j][k] (to neuron j of layer l+1 from neuron k of layer l, bias last),
+/// and the activations of a block of kBlockSize events as one row per
+/// neuron, so that each layer is a small matrix product whose inner loop
+/// runs over the events and vectorizes, as do the activations (vec_math.h).
+/// The Workspace holds the activation buffers, so nothing is allocated per
+/// event or per block.
+///
+/// The computation is done in single precision (TMVA uses double). The
+/// activations are those of TMVA (PadeTanh reproduces TActivationTanh bit
+/// for bit for the same argument), so the remaining differences come from
+/// the rounding of the weighted sums: below 3e-7 on a synthetic 2-12-7-1
+/// tanh network. mlp_native.cpp measures them for a trained network.
+
+#ifndef MLP_NATIVE_H
+#define MLP_NATIVE_H
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tmva_weights.h"
+#include "binary_model.h"
+#include "vec_math.h"
+
+class NativeMLP {
+
+public:
+
+   static const size_t kBlockSize = 256;   // events per block in EvaluateBatch
+   static const int    kMaxVar    = 64;    // input variables (at most)
+
+   enum EActivation { kLinear = 0, kSigmoid, kTanh, kRadial };
+
+   // per-thread activation buffers, two layers of kBlockSize events
+   struct Workspace {
+      std::vector<float> fIn;
+      std::vector<float> fOut;
+   };
+
+   NativeMLP() : fHidden( kTanh ), fOutput( kSigmoid ), fMaxWidth( 0 ) {}
+
+   // ---------------------------------------------------------------------------
+
+   bool LoadXML( const std::string& fileName )
+   {
+      TMVAWeightsFile wf;
+      if (!wf.Open( fileName )) return false;
+
+      if (wf.Method().compare( 0, 5, "MLP::" ) != 0) {
+         std::cout << "==> ERROR: " << fileName << " is not a MLP weight file" << std::endl;
+         return false;
+      }
+      if (!wf.NormalizeRanges( fNormMin, fNormMax )) return false;
+
+      std::string neuronType = wf.Option( "NeuronType" );
+      if      (neuronType == "tanh")    fHidden = kTanh;
+      else if (neuronType == "sigmoid") fHidden = kSigmoid;
+      else if (neuronType == "linear")  fHidden = kLinear;
+      else if (neuronType == "radial")  fHidden = kRadial;
+      else {
+         std::cout << "==> ERROR: " << fileName << ": unsupported NeuronType " << neuronType << std::endl;
+         return false;
+      }
+      if (wf.Option( "NeuronInputType" ) != "" && wf.Option( "NeuronInputType" ) != "sum") {
+         std::cout << "==> ERROR: " << fileName << ": unsupported NeuronInputType " << wf.Option( "NeuronInputType" ) << std::endl;
+         return false;
+      }
+      fOutput = (wf.Option( "EstimatorType" ) == "MSE") ? kLinear : kSigmoid;
+
+      // <Layout NLayers> <Layer Index NNeurons> <Neuron NSynapses> w w ... </Neuron>
+      std::vector< std::vector< std::vector<double> > > synapses;   // [layer][neuron][synapse]
+      XMLNodePointer_t layout = wf.Child( wf.Child( wf.Root(), "Weights" ), "Layout" );
+      for (XMLNodePointer_t layer = wf.Child( layout, "Layer" ); layer; layer = wf.Next( layer, "Layer" )) {
+         synapses.push_back( std::vector< std::vector<double> >() );
+         for (XMLNodePointer_t neuron = wf.Child( layer, "Neuron" ); neuron; neuron = wf.Next( neuron, "Neuron" )) {
+            std::vector<double> w( wf.AttrI( neuron, "NSynapses" ) );
+            std::istringstream content( wf.Content( neuron ) );
+            for (size_t k = 0; k < w.size(); k++) content >> w[k];
+            if (!content) {
+               std::cout << "==> ERROR: " << fileName << ": cannot read the synapse weights" << std::endl;
+               return false;
+            }
+            synapses.back().push_back( w );
+         }
+      }
+
+      // layer sizes without the bias neurons
+      size_t nLayers = synapses.size();
+      if (nLayers < 2 || synapses.back().size() != 1) {
+         std::cout << "==> ERROR: " << fileName << ": no network with one output neuron" << std::endl;
+         return false;
+      }
+      fSizes.clear();
+      for (size_t l = 0; l + 1 < nLayers; l++) fSizes.push_back( synapses[l].size() - 1 );
+      fSizes.push_back( 1 );
+      if ((size_t) fSizes[0] != wf.Variables().size() || fSizes[0] > kMaxVar ||
+          (!fNormMin.empty() && fNormMin.size() != (size_t) fSizes[0])) {
+         std::cout << "==> ERROR: " << fileName << ": the input layer does not match the variables" << std::endl;
+         return false;
+      }
+
+      fWeights.clear();
+      for (size_t l = 0; l + 1 < nLayers; l++) {
+         int nIn = fSizes[l], nOut = fSizes[l+1];
+         for (int j = 0; j < nOut; j++) {
+            for (int k = 0; k <= nIn; k++) {
+               if (synapses[l][k].size() != (size_t) nOut) {
+                  std::cout << "==> ERROR: " << fileName << ": layer " << l << " is not fully connected" << std::endl;
+                  return false;
+               }
+               fWeights.push_back( synapses[l][k][j] );
+            }
+         }
+      }
+      Setup();
+
+      std::cout << "==> NativeMLP: layers";
+      for (size_t l = 0; l < fSizes.size(); l++) std::cout << " " << fSizes[l];
+      std::cout << ", " << fWeights.size() << " weights" << std::endl;
+      return true;
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // responses of n events, variable v of event i in x[v][i]
+   void EvaluateBatch( size_t n, const float* const* x, float* response, Workspace& ws ) const
+   {
+      size_t bufferSize = fMaxWidth * kBlockSize;
+      if (ws.fIn.size() < bufferSize) {
+         ws.fIn.resize( bufferSize );
+         ws.fOut.resize( bufferSize );
+      }
+
+      for (size_t first = 0; first < n; first += kBlockSize) {
+         size_t nb = std::min( kBlockSize, n - first );
+
+         // input layer, normalized: row v holds variable v of the block
+         float *in = &ws.fIn[0], *out = &ws.fOut[0];
+         for (int v = 0; v < fSizes[0]; v++) {
+            const float *xv = x[v] + first;
+            float       *a  = in + v * kBlockSize;
+            float scale = fScale[v], offset = fOffset[v];
+            for (size_t i = 0; i < nb; i++) a[i] = xv[i] * scale + offset;
+         }
+
+         // out = W in + bias, then the activation
+         const float *w = &fWeights[0];
+         for (size_t l = 0; l + 1 < fSizes.size(); l++) {
+            int nIn = fSizes[l], nOut = fSizes[l+1];
+            for (int j = 0; j < nOut; j++, w += nIn + 1) {
+               float *o = out + j * kBlockSize;
+               float bias = w[nIn];
+               for (size_t i = 0; i < nb; i++) o[i] = bias;
+               for (int k = 0; k < nIn; k++) {
+                  const float *a = in + k * kBlockSize;
+                  float wk = w[k];
+                  for (size_t i = 0; i < nb; i++) o[i] += wk * a[i];
+               }
+            }
+            Activate( l + 2 == fSizes.size() ? fOutput : fHidden, out, nOut, nb );
+            std::swap( in, out );
+         }
+
+         for (size_t i = 0; i < nb; i++) response[first + i] = in[i];
+      }
+   }
+
+   // response for the event with input variables x[0..NVar-1]
+   float Evaluate( const float* x, Workspace& ws ) const
+   {
+      const float *xv[kMaxVar];
+      for (int v = 0; v < fSizes[0]; v++) xv[v] = &x[v];
+      float response;
+      EvaluateBatch( 1, xv, &response, ws );
+      return response;
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // binary model file: params [hidden activation, output activation, layer sizes...],
+   // normalization ranges and weight matrices
+   bool WriteBinary( const std::string& fileName ) const
+   {
+      std::vector<double> params;
+      params.push_back( fHidden );
+      params.push_back( fOutput );
+      for (size_t l = 0; l < fSizes.size(); l++) params.push_back( fSizes[l] );
+
+      BinaryModelWriter out( BinaryModel::kMLP, fSizes[0] );
+      out.Add( kParams,  params );
+      out.Add( kNormMin, fNormMin );
+      out.Add( kNormMax, fNormMax );
+      out.Add( kWeights, fWeights );
+      return out.Write( fileName );
+   }
+
+   bool LoadBinary( const std::string& fileName )
+   {
+      BinaryModel in;
+      if (!in.Open( fileName )) return false;
+      if (in.Type() != BinaryModel::kMLP) {
+         std::cout << "==> ERROR: " << fileName << " is not a MLP model" << std::endl;
+         return false;
+      }
+
+      std::vector<double> params;
+      if (!in.Get( kParams, params ) || params.size() < 4) return false;
+      fHidden = (EActivation) params[0];
+      fOutput = (EActivation) params[1];
+      fSizes.assign( params.begin() + 2, params.end() );
+
+      if (!in.Get( kNormMin, fNormMin ) || !in.Get( kNormMax, fNormMax ) || !in.Get( kWeights, fWeights )) return false;
+
+      size_t nWeights = 0;
+      for (size_t l = 0; l + 1 < fSizes.size(); l++) nWeights += (size_t) (fSizes[l] + 1) * fSizes[l+1];
+      if ((size_t) fSizes[0] != in.NVar() || fSizes[0] > kMaxVar || fSizes.back() != 1 || fWeights.size() != nWeights ||
+          fNormMin.size() != fNormMax.size() || (!fNormMin.empty() && fNormMin.size() != in.NVar())) {
+         std::cout << "==> ERROR: " << fileName << ": inconsistent network" << std::endl;
+         return false;
+      }
+      Setup();
+      return true;
+   }
+
+   int GetNVar()    const { return fSizes.empty() ? 0 : fSizes[0]; }
+   int GetNLayers() const { return fSizes.size(); }
+   int GetNeurons( int l ) const { return fSizes[l]; }
+
+private:
+
+   // sections of the binary model file
+   enum { kParams = 1, kNormMin, kNormMax, kWeights };
+
+   EActivation          fHidden;
+   EActivation          fOutput;
+   std::vector<int>     fSizes;       // neurons per layer, without bias
+   std::vector<float>   fWeights;     // per layer, W[j][k] row-major, bias in column nIn
+   std::vector<double>  fNormMin;     // Normalize ranges (empty: none)
+   std::vector<double>  fNormMax;
+   std::vector<float>   fScale;       // normalization as x * scale + offset
+   std::vector<float>   fOffset;
+   size_t               fMaxWidth;
+
+   void Setup()
+   {
+      fMaxWidth = 0;
+      for (size_t l = 0; l < fSizes.size(); l++) fMaxWidth = std::max( fMaxWidth, (size_t) fSizes[l] );
+
+      fScale.assign( fSizes[0], 1 );
+      fOffset.assign( fSizes[0], 0 );
+      for (size_t v = 0; v < fNormMin.size(); v++) {
+         double range = fNormMax[v] - fNormMin[v];
+         if (range <= 0) continue;
+         fScale[v]  = 2 / range;
+         fOffset[v] = -2 * fNormMin[v] / range - 1;
+      }
+   }
+
+   static void Activate( EActivation type, float* a, int nNeurons, size_t nb )
+   {
+      for (int j = 0; j < nNeurons; j++) {
+         float *o = a + j * kBlockSize;
+         switch (type) {
+            case kTanh:    for (size_t i = 0; i < nb; i++) o[i] = PadeTanh( o[i] );                break;
+            case kSigmoid: for (size_t i = 0; i < nb; i++) o[i] = FastSigmoid( o[i] );             break;
+            case kRadial:  for (size_t i = 0; i < nb; i++) o[i] = FastExp( -0.5f * o[i] * o[i] ); break;
+            case kLinear:  break;
+         }
+      }
+   }
+
+};
+
+#endif
@@ -0,0 +1,105 @@
+/// Exports trained methods as binary model files (binary_model.h)
+///
+/// For every given method the weight file
+/// dataset/weights/classification_<Method>.weights.xml is read once, the
+/// native evaluator is built from it, and its arrays are written to
+///
+///     dataset/weights/classification_<Method>.model
+///
+/// which the analysis loads instead of the XML file (no parsing, and for
+/// KNN no rebuilding of the search tree).
+///
+///     make -f Makefile_model_export
+///     ./model_export KNN BDT
+///
+/// Supported: KNN (NativeKNN, 2 variables), BDT (FlatForest), MLP (NativeMLP)
+/// and SVM (NativeSVM)
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <TStopwatch.h>
+
+#include "tmva_weights.h"
+#include "knn_native.h"
+#include "bdt_forest.h"
+#include "mlp_native.h"
+#include "svm_native.h"
+
+// weight file and model file of a method
+inline std::string WeightFileName( const std::string& method )
+{
+   return "dataset/weights/classification_" + method + ".weights.xml";
+}
+
+inline std::string ModelFileName( const std::string& method )
+{
+   return "dataset/weights/classification_" + method + ".model";
+}
+
+// Builds model from the XML weight file, writes it as a binary model file and
+// reloads that, printing both loading times
+template <class Model>
+bool Export( Model& model, const std::string& method, const std::string& xmlFile, const std::string& modelFile )
+{
+   TStopwatch timer;
+   timer.Start();
+   bool ok = model.LoadXML( xmlFile );
+   timer.Stop();
+   if (!ok || !model.WriteBinary( modelFile )) return false;
+
+   double xmlTime = timer.RealTime();
+   timer.Start();
+   ok = model.LoadBinary( modelFile );
+   timer.Stop();
+   if (ok) std::cout << "==> " << method << ": loading from XML " << xmlTime << " s, from model " << timer.RealTime() << " s" << std::endl;
+   return ok;
+}
+
+bool ExportMethod( const std::string& method )
+{
+   std::string xmlFile   = WeightFileName( method );
+   std::string modelFile = ModelFileName( method );
+
+   // method type from the weight file, e.g. Method="BDT::BDTG"
+   std::string type;
+   {
+      TMVAWeightsFile wf;
+      if (!wf.Open( xmlFile )) return false;
+      type = wf.Method().substr( 0, wf.Method().find( "::" ) );
+   }
+
+   if (type == "KNN") {
+      NativeKNN<2> knn;
+      return Export( knn, method, xmlFile, modelFile );
+   } else if (type == "BDT") {
+      FlatForest bdt;
+      return Export( bdt, method, xmlFile, modelFile );
+   } else if (type == "MLP") {
+      NativeMLP mlp;
+      return Export( mlp, method, xmlFile, modelFile );
+   } else if (type == "SVM") {
+      NativeSVM svm;
+      return Export( svm, method, xmlFile, modelFile );
+   }
+
+   std::cout << "==> ERROR: " << method << ": method type " << type << " has no binary model" << std::endl;
+   return false;
+}
+
+int main( int argc, char** argv )
+{
+   std::vector<std::string> methods;
+   for (int i = 1; i < argc; i++) methods.push_back( argv[i] );
+   if (methods.empty()) {
+      methods.push_back( "KNN" );
+      methods.push_back( "BDT" );
+   }
+
+   int nFailed = 0;
+   for (size_t i = 0; i < methods.size(); i++)
+      if (!ExportMethod( methods[i] )) nFailed++;
+
+   return nFailed == 0 ? 0 : 1;
+}
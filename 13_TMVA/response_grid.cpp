@@ -0,0 +1,176 @@
+/// Tabulates the response of trained methods on a (var1, var2) grid
+///
+/// For every given method (default KNN) the response is evaluated by TMVA
+/// Readers (one per thread) on an N x N grid covering the range of the
+/// training samples, and written to
+///
+///     dataset/weights/classification_<Method>.grid
+///
+/// which "./analysis -j N --grid -m <Methods>" evaluates by bilinear
+/// interpolation (response_grid.h). The accuracy of the grid is then checked
+/// on the events of data.txt against the direct evaluation: maximum and RMS
+/// difference, the fraction of events classified differently with a cut at
+/// the median response, and the time per event of both.
+///
+///     make -f Makefile_response_grid
+///     ./response_grid [-j N] [-n N] [--sample dir] [Methods]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <TString.h>
+#include <TROOT.h>
+
+#include <TMVA/Reader.h>
+#include <TMVA/MethodBase.h>
+
+#include "batch_eval.h"
+#include "response_grid.h"
+
+// Relative margin added around the range of the training samples
+const double kMargin = 0.01;
+
+// Per-thread Reader with one method booked
+struct GridWorker {
+   TMVA::Reader     *reader;
+   TMVA::MethodBase *method;
+   Float_t           var1;
+   Float_t           var2;
+};
+
+int main( int argc, char** argv )
+{
+   int nThreads = 0;
+   int nNodes   = 512;
+   std::string sample = "sample_good_separation";
+   std::vector<std::string> methods;
+   for (int i = 1; i < argc; i++) {
+      std::string arg( argv[i] );
+      if      ((arg == "-j" || arg == "--jobs") && i + 1 < argc) nThreads = atoi( argv[++i] );
+      else if (arg == "-n" && i + 1 < argc)                      nNodes   = atoi( argv[++i] );
+      else if (arg == "--sample" && i + 1 < argc)               sample   = argv[++i];
+      else                                                        methods.push_back( arg );
+   }
+   if (methods.empty()) methods.push_back( "KNN" );
+
+   ROOT::EnableThreadSafety();
+   nThreads = NumberOfThreads( nThreads );
+
+   // Grid range: the training samples, with a margin
+   EventData signal, background, data;
+   if (!LoadEventData( sample + "/signal.txt", signal, nThreads ) ||
+       !LoadEventData( sample + "/background.txt", background, nThreads ) ||
+       !LoadEventData( sample + "/data.txt", data, nThreads )) return 1;
+
+   float xmin = 1e30, xmax = -1e30, ymin = 1e30, ymax = -1e30;
+   const EventData *training[2] = { &signal, &background };
+   for (int s = 0; s < 2; s++) {
+      for (size_t i = 0; i < training[s]->size(); i++) {
+         xmin = std::min( xmin, training[s]->var1[i] );
+         xmax = std::max( xmax, training[s]->var1[i] );
+         ymin = std::min( ymin, training[s]->var2[i] );
+         ymax = std::max( ymax, training[s]->var2[i] );
+      }
+   }
+   if (!(xmax > xmin) || !(ymax > ymin)) {
+      std::cout << "==> ERROR: empty training samples in " << sample << std::endl;
+      return 1;
+   }
+   double mx = kMargin * (xmax - xmin), my = kMargin * (ymax - ymin);
+
+   size_t nData = data.size(), nOutside = 0;
+
+   for (size_t m = 0; m < methods.size(); m++) {
+      const std::string &method = methods[m];
+      std::string weightfile = "dataset/weights/classification_" + method + ".weights.xml";
+      std::string gridfile   = "dataset/weights/classification_" + method + ".grid";
+      double aux = (method.compare( 0, 4, "Cuts" ) == 0) ? 0.5 : 0;
+
+      std::vector<GridWorker> workers( nThreads );
+      bool booked = true;
+      for (int i = 0; i < nThreads; i++) {
+         GridWorker &w = workers[i];
+         w.reader = new TMVA::Reader( "!Color:Silent" );
+         w.reader->AddVariable( "var1", &w.var1 );
+         w.reader->AddVariable( "var2", &w.var2 );
+         w.method = dynamic_cast<TMVA::MethodBase*>( w.reader->BookMVA( method + " method", weightfile ) );
+         booked = booked && w.method;
+      }
+      if (!booked) {
+         std::cout << "==> ERROR: cannot book " << method << " from " << weightfile << std::endl;
+         for (int i = 0; i < nThreads; i++) delete workers[i].reader;
+         continue;
+      }
+
+      // Tabulate
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      ResponseGrid grid( nNodes, nNodes, xmin - mx, xmax + mx, ymin - my, ymax + my );
+      grid.Fill( nThreads, [&]( int iThread, double x, double y ) {
+         GridWorker &w = workers[iThread];
+         w.var1 = x;
+         w.var2 = y;
+         return (float) w.reader->EvaluateMVA( w.method, aux );
+      } );
+      double fillTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+      std::cout << "==> " << method << ": " << nNodes << " x " << nNodes << " grid filled in " << fillTime << " s" << std::endl;
+      if (!grid.WriteBinary( gridfile )) return 1;
+
+      // Direct evaluation of the data
+      std::vector<float> direct( nData ), interpolated( nData );
+      start = std::chrono::steady_clock::now();
+      ProcessBlocks( nData, 16384, nThreads, [&]( int iThread, size_t first, size_t last ) {
+         GridWorker &w = workers[iThread];
+         for (size_t i = first; i < last; i++) {
+            w.var1 = data.var1[i];
+            w.var2 = data.var2[i];
+            direct[i] = w.reader->EvaluateMVA( w.method, aux );
+         }
+      } );
+      double directTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+      // ... and from the grid, reloaded from its file
+      ResponseGrid loaded;
+      if (!loaded.LoadBinary( gridfile )) return 1;
+      start = std::chrono::steady_clock::now();
+      ProcessBlocks( nData, 16384, nThreads, [&]( int, size_t first, size_t last ) {
+         const float *x[2] = { &data.var1[first], &data.var2[first] };
+         loaded.EvaluateBatch( last - first, x, &interpolated[first] );
+      } );
+      double gridTime = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+      // Accuracy, with a cut at the median of the direct response
+      std::vector<float> sorted( direct );
+      std::nth_element( sorted.begin(), sorted.begin() + nData / 2, sorted.end() );
+      float cut = nData ? sorted[nData / 2] : 0;
+
+      double maxDiff = 0, sum2 = 0;
+      size_t nFlipped = 0;
+      nOutside = 0;
+      for (size_t i = 0; i < nData; i++) {
+         double d = std::fabs( interpolated[i] - direct[i] );
+         maxDiff = std::max( maxDiff, d );
+         sum2 += d * d;
+         if ((interpolated[i] >= cut) != (direct[i] >= cut)) nFlipped++;
+         if (!loaded.Inside( data.var1[i], data.var2[i] )) nOutside++;
+      }
+
+      std::cout << "==> " << method << " on " << nData << " events: max |grid - direct| " << maxDiff
+                << ", RMS " << (nData ? std::sqrt( sum2 / nData ) : 0)
+                << ", different decision at cut " << cut << " for " << nFlipped << " events ("
+                << (nData ? 100. * nFlipped / nData : 0) << "%)" << std::endl;
+      std::cout << "==> " << method << " time per event on " << nThreads << " threads: direct "
+                << 1e9 * directTime / std::max<size_t>( nData, 1 ) << " ns, grid "
+                << 1e9 * gridTime / std::max<size_t>( nData, 1 ) << " ns" << std::endl;
+
+      for (int i = 0; i < nThreads; i++) delete workers[i].reader;
+   }
+
+   if (nOutside > 0)
+      std::cout << "==> " << nOutside << " data events are outside the grid (response of the nearest border point)" << std::endl;
+   return 0;
+}
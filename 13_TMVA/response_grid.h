@@ -0,0 +1,164 @@
+/// Tabulated response of a classifier of two input variables
+///
+/// For the two-variable samples of this exercise, the response of any trained
+/// method can be computed once on a fine (var1, var2) grid and then evaluated
+/// by bilinear interpolation between the four surrounding nodes, at a cost
+/// that does not depend on the method (a KNN search, or hundreds of trees):
+///
+///    ResponseGrid grid( 512, 512, xmin, xmax, ymin, ymax );
+///    grid.Fill( nThreads, [&]( int iThread, double x, double y ) { return ...; } );
+///    grid.WriteBinary( "dataset/weights/classification_KNN.grid" );
+///
+///    ResponseGrid grid;
+///    grid.LoadBinary( "dataset/weights/classification_KNN.grid" );
+///    float response = grid.Evaluate( var1, var2 );
+///
+/// Outside the grid the response is the one of the nearest border point.
+/// The interpolation smooths steps of the response (cuts of the trees, the
+/// discrete KNN fractions) over one grid cell, so the accuracy should be
+/// checked against the direct evaluation, see response_grid.cpp.
+
+#ifndef RESPONSE_GRID_H
+#define RESPONSE_GRID_H
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "batch_eval.h"
+#include "binary_model.h"
+
+class ResponseGrid {
+
+public:
+
+   ResponseGrid() : fNx( 0 ), fNy( 0 ), fXmin( 0 ), fXmax( 0 ), fYmin( 0 ), fYmax( 0 ), fDx( 0 ), fDy( 0 ) {}
+
+   // nx x ny nodes, the first and last on the borders of the range
+   ResponseGrid( int nx, int ny, double xmin, double xmax, double ymin, double ymax )
+   {
+      SetGrid( nx, ny, xmin, xmax, ymin, ymax );
+   }
+
+   void SetGrid( int nx, int ny, double xmin, double xmax, double ymin, double ymax )
+   {
+      fNx   = std::max( nx, 2 );
+      fNy   = std::max( ny, 2 );
+      fXmin = xmin;
+      fXmax = xmax;
+      fYmin = ymin;
+      fYmax = ymax;
+      fValues.assign( (size_t) fNx * fNy, 0 );
+      SetSteps();
+   }
+
+   // response( iThread, x, y ) at every node, rows of nodes distributed over nThreads threads
+   template <typename Func>
+   void Fill( int nThreads, Func response )
+   {
+      ProcessBlocks( fNy, 1, nThreads, [&]( int iThread, size_t first, size_t last ) {
+         for (size_t j = first; j < last; j++)
+            for (int i = 0; i < fNx; i++)
+               fValues[j * fNx + i] = response( iThread, X( i ), Y( j ) );
+      } );
+   }
+
+   // ---------------------------------------------------------------------------
+
+   float Evaluate( float x, float y ) const
+   {
+      float u = (x - fXmin) * fDx;
+      float v = (y - fYmin) * fDy;
+      u = std::min( std::max( u, 0.f ), (float) (fNx - 1) );
+      v = std::min( std::max( v, 0.f ), (float) (fNy - 1) );
+      int i = std::min( (int) u, fNx - 2 );
+      int j = std::min( (int) v, fNy - 2 );
+      float fu = u - i, fv = v - j;
+
+      const float *f = &fValues[(size_t) j * fNx + i];
+      float bottom = f[0]   + fu * (f[1] - f[0]);
+      float top    = f[fNx] + fu * (f[fNx + 1] - f[fNx]);
+      return bottom + fv * (top - bottom);
+   }
+
+   // responses of n events, variable v of event i in x[v][i]
+   void EvaluateBatch( size_t n, const float* const* x, float* response ) const
+   {
+      for (size_t i = 0; i < n; i++) response[i] = Evaluate( x[0][i], x[1][i] );
+   }
+
+   bool Inside( float x, float y ) const { return x >= fXmin && x <= fXmax && y >= fYmin && y <= fYmax; }
+
+   double X( int i ) const { return fXmin + (fXmax - fXmin) * i / (fNx - 1); }
+   double Y( int j ) const { return fYmin + (fYmax - fYmin) * j / (fNy - 1); }
+
+   int GetNx() const { return fNx; }
+   int GetNy() const { return fNy; }
+
+   // ---------------------------------------------------------------------------
+
+   // binary model file (binary_model.h): [nx, ny, xmin, xmax, ymin, ymax], values
+   bool WriteBinary( const std::string& fileName ) const
+   {
+      std::vector<double> params;
+      params.push_back( fNx );
+      params.push_back( fNy );
+      params.push_back( fXmin );
+      params.push_back( fXmax );
+      params.push_back( fYmin );
+      params.push_back( fYmax );
+
+      BinaryModelWriter out( BinaryModel::kGrid, 2 );
+      out.Add( kParams, params );
+      out.Add( kValues, fValues );
+      return out.Write( fileName );
+   }
+
+   bool LoadBinary( const std::string& fileName )
+   {
+      BinaryModel in;
+      if (!in.Open( fileName )) return false;
+      if (in.Type() != BinaryModel::kGrid || in.NVar() != 2) {
+         std::cout << "==> ERROR: " << fileName << " is not a response grid" << std::endl;
+         return false;
+      }
+
+      std::vector<double> params;
+      if (!in.Get( kParams, params ) || params.size() != 6 || !in.Get( kValues, fValues )) return false;
+      fNx   = (int) params[0];
+      fNy   = (int) params[1];
+      fXmin = params[2];
+      fXmax = params[3];
+      fYmin = params[4];
+      fYmax = params[5];
+      if (fNx < 2 || fNy < 2 || fValues.size() != (size_t) fNx * fNy || !(fXmax > fXmin) || !(fYmax > fYmin)) {
+         std::cout << "==> ERROR: " << fileName << ": inconsistent grid" << std::endl;
+         return false;
+      }
+      SetSteps();
+
+      std::cout << "==> ResponseGrid: " << fNx << " x " << fNy << " nodes, var1 in [" << fXmin << ", " << fXmax
+                << "], var2 in [" << fYmin << ", " << fYmax << "]" << std::endl;
+      return true;
+   }
+
+private:
+
+   enum { kParams = 1, kValues };
+
+   int                 fNx, fNy;
+   double              fXmin, fXmax, fYmin, fYmax;
+   float               fDx, fDy;        // inverse node spacing
+   std::vector<float>  fValues;         // node (i, j) at j * fNx + i
+
+   void SetSteps()
+   {
+      fDx = (fXmax > fXmin) ? (fNx - 1) / (fXmax - fXmin) : 0;
+      fDy = (fYmax > fYmin) ? (fNy - 1) / (fYmax - fYmin) : 0;
+   }
+
+};
+
+#endif
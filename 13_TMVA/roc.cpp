@@ -0,0 +1,179 @@
+/// Exact ROC curves, AUC and signal efficiencies of the trained classifiers
+///
+/// Reads the test tree dataset/TestTree of the TMVA output files (TMVA.root,
+/// or the TMVA_<Method>.root files of the parallel training), which holds for
+/// every test event its class (classID 0 = signal), its weight and one
+/// column per method, and fills an exact score histogram (roc_exact.h) per
+/// method on all threads. The histograms of several files are merged, and so
+/// are histograms saved by earlier runs with --save (roc_<Method>.hist), so
+/// large test samples can be scored in independent jobs and combined later:
+///
+///     make -f Makefile_roc
+///     ./roc [-j N] [--max-bins N] [--save] [TMVA.root ...] [roc_KNN.hist ...]
+///
+/// For every method the AUC and the signal efficiency at 90%, 99% and 99.9%
+/// background rejection are printed, and the ROC curve is written to roc.root
+/// as the graph "roc_<Method>" (signal efficiency vs background rejection, as
+/// in the TMVA GUI). With --max-bins the memory per method is bounded and the
+/// AUC is given with its maximum error.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <TFile.h>
+#include <TGraph.h>
+#include <TLeaf.h>
+#include <TObjArray.h>
+#include <TROOT.h>
+#include <TStopwatch.h>
+#include <TTree.h>
+
+#include "roc_exact.h"
+
+// Entries read per chunk of the test tree
+const Long64_t kChunkSize = 1 << 20;
+
+// Points of the written ROC graphs (at most)
+const size_t kMaxGraphPoints = 10000;
+
+// Fill the score histogram of every method column of the test tree of fileName
+bool FillFromTree( const std::string& fileName, std::map<std::string, ScoreHistogram>& hists,
+                   int nThreads, size_t maxBins )
+{
+   TFile *file = TFile::Open( fileName.c_str() );
+   TTree *tree = file ? (TTree*) file->Get( "dataset/TestTree" ) : 0;
+   if (!tree) {
+      std::cout << "==> ERROR: no dataset/TestTree in " << fileName << std::endl;
+      delete file;
+      return false;
+   }
+
+   // method columns: the Float_t branches that are not inputs or weights
+   std::vector<std::string> methods;
+   TObjArray *branches = tree->GetListOfBranches();
+   for (int i = 0; i < branches->GetEntries(); i++) {
+      std::string name = branches->At( i )->GetName();
+      TLeaf *leaf = tree->GetLeaf( name.c_str() );
+      if (!leaf || std::string( leaf->GetTypeName() ) != "Float_t") continue;
+      if (name == "var1" || name == "var2" || name == "weight") continue;
+      methods.push_back( name );
+   }
+
+   Int_t   classID = 0;
+   Float_t weight  = 1;
+   std::vector<Float_t> value( methods.size() );
+   tree->SetBranchStatus( "*", 0 );
+   tree->SetBranchStatus( "classID", 1 );
+   tree->SetBranchStatus( "weight", 1 );
+   tree->SetBranchAddress( "classID", &classID );
+   tree->SetBranchAddress( "weight", &weight );
+   for (size_t m = 0; m < methods.size(); m++) {
+      tree->SetBranchStatus( methods[m].c_str(), 1 );
+      tree->SetBranchAddress( methods[m].c_str(), &value[m] );
+      hists[methods[m]].SetMaxBins( maxBins );
+   }
+
+   // one pass over the tree, chunk by chunk, all methods at once
+   Long64_t nEntries = tree->GetEntries();
+   std::vector<char>  isSignal;
+   std::vector<float> weights;
+   std::vector< std::vector<float> > scores( methods.size() );
+   for (Long64_t first = 0; first < nEntries; first += kChunkSize) {
+      Long64_t n = std::min( kChunkSize, nEntries - first );
+      isSignal.resize( n );
+      weights.resize( n );
+      for (size_t m = 0; m < methods.size(); m++) scores[m].resize( n );
+
+      for (Long64_t i = 0; i < n; i++) {
+         tree->GetEntry( first + i );
+         isSignal[i] = (classID == 0);
+         weights[i]  = weight;
+         for (size_t m = 0; m < methods.size(); m++) scores[m][i] = value[m];
+      }
+      for (size_t m = 0; m < methods.size(); m++)
+         FillParallel( hists[methods[m]], n, &scores[m][0], &isSignal[0], &weights[0], nThreads, maxBins );
+   }
+
+   std::cout << "==> " << fileName << ": " << nEntries << " test events, " << methods.size() << " methods" << std::endl;
+   file->Close();
+   delete file;
+   return true;
+}
+
+// ROC graph: signal efficiency vs background rejection, thinned to kMaxGraphPoints
+TGraph* MakeGraph( const std::string& method, const std::vector<ScoreHistogram::Point>& curve )
+{
+   size_t step = (curve.size() + kMaxGraphPoints - 1) / kMaxGraphPoints;
+   TGraph *g = new TGraph();
+   g->SetName( ("roc_" + method).c_str() );
+   g->SetTitle( (method + ";Signal efficiency;Background rejection").c_str() );
+   for (size_t i = 0; i < curve.size(); i += step) g->SetPoint( g->GetN(), curve[i].effS, 1 - curve[i].effB );
+   if ((curve.size() - 1) % step != 0) g->SetPoint( g->GetN(), curve.back().effS, 1 - curve.back().effB );
+   return g;
+}
+
+int main( int argc, char** argv )
+{
+   int    nThreads = 0;
+   size_t maxBins  = 0;
+   bool   save     = false;
+   std::vector<std::string> inputs;
+   for (int i = 1; i < argc; i++) {
+      std::string arg( argv[i] );
+      if      ((arg == "-j" || arg == "--jobs") && i + 1 < argc) nThreads = atoi( argv[++i] );
+      else if (arg == "--max-bins" && i + 1 < argc)            maxBins  = atol( argv[++i] );
+      else if (arg == "--save")                                save     = true;
+      else                                                      inputs.push_back( arg );
+   }
+   if (inputs.empty()) inputs.push_back( "TMVA.root" );
+
+   ROOT::EnableThreadSafety();
+   TStopwatch timer;
+
+   std::map<std::string, ScoreHistogram> hists;
+   for (size_t f = 0; f < inputs.size(); f++) {
+      const std::string &input = inputs[f];
+      size_t ext = input.rfind( ".hist" );
+      if (ext != std::string::npos && ext + 5 == input.size()) {
+         // saved histogram roc_<Method>.hist
+         size_t slash = input.rfind( '/' );
+         std::string method = input.substr( slash == std::string::npos ? 0 : slash + 1 );
+         method = method.substr( 0, method.size() - 5 );
+         if (method.compare( 0, 4, "roc_" ) == 0) method = method.substr( 4 );
+         ScoreHistogram h;
+         if (!h.Read( input )) return 1;
+         hists[method].SetMaxBins( maxBins );
+         hists[method].Merge( h );
+         std::cout << "==> " << input << ": " << method << std::endl;
+      } else if (!FillFromTree( input, hists, nThreads, maxBins )) {
+         return 1;
+      }
+   }
+
+   std::cout << "==> Filled in " << timer.RealTime() << " s" << std::endl;
+
+   TFile *out = new TFile( "roc.root", "RECREATE" );
+
+   printf( "%-16s %10s %10s %12s %10s %10s %10s\n", "Method", "SumW", "Bins", "AUC", "effS@0.9", "effS@0.99", "effS@0.999" );
+   for (std::map<std::string, ScoreHistogram>::iterator it = hists.begin(); it != hists.end(); ++it) {
+      ScoreHistogram &h = it->second;
+      double bound = h.AUCErrorBound();
+      printf( "%-16s %10.0f %10zu %12.6f %10.4f %10.4f %10.4f", it->first.c_str(), h.SumSignal() + h.SumBackground(),
+              h.NBins(), h.AUC(), h.SignalEfficiency( 0.9 ), h.SignalEfficiency( 0.99 ), h.SignalEfficiency( 0.999 ) );
+      if (bound > 0) printf( "   (AUC +- %.2g, %d key bits)", bound, h.KeyBits() );
+      if (h.NaNs() > 0) printf( "   (%zu NaN scores ignored)", h.NaNs() );
+      printf( "\n" );
+
+      MakeGraph( it->first, h.Curve() )->Write();
+      if (save) h.Write( "roc_" + it->first + ".hist" );
+   }
+
+   out->Close();
+   std::cout << "==> Wrote roc.root" << std::endl;
+   return 0;
+}
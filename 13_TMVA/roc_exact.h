@@ -0,0 +1,349 @@
+/// Exact ROC curves and AUC from per-event classifier scores
+///
+/// TMVA builds the ROC curve and its integral from binned histograms of the
+/// classifier output, which limits the precision at high background
+/// rejection. ScoreHistogram instead accumulates the signal and background
+/// weights per distinct score value, so that the ROC curve, its area (AUC)
+/// and the signal efficiency at a given background rejection are exact:
+///
+///    ScoreHistogram h;
+///    for (...) h.Fill( score, isSignal, weight );
+///    double auc  = h.AUC();
+///    double effS = h.SignalEfficiency( 0.99 );      // at 99% background rejection
+///
+/// The scores are mapped to order-preserving 32-bit keys. Filled events go to
+/// a buffer which, when full, is radix sorted and merged into the sorted list
+/// of (key, signal weight, background weight) bins, so the memory is set by
+/// the number of distinct scores, not by the number of events. To bound it,
+/// SetMaxBins( n ) drops the lowest key bits whenever there are more than n
+/// bins: the ROC is then exact for the coarsened scores, and AUCErrorBound()
+/// gives the maximum difference to the exact AUC (events sharing a bin count
+/// as ties).
+///
+/// Partial histograms filled by several threads, or saved to files by
+/// several jobs, are combined with Merge:
+///
+///    FillParallel( h, n, score, isSignal, weight, nThreads );
+///    h.Write( "roc_KNN.hist" );  ...  other.Read( "roc_KNN.hist" ); h.Merge( other );
+///
+/// Ties (equal scores of signal and background events) are counted with
+/// weight 1/2 in the AUC and give straight segments of the ROC curve, i.e.
+/// the expectation for a random ordering of the tied events.
+
+#ifndef ROC_EXACT_H
+#define ROC_EXACT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_eval.h"
+
+class ScoreHistogram {
+
+public:
+
+   static const size_t kBufferSize = 1 << 20;   // events buffered before sorting
+
+   struct Bin {
+      uint32_t key;
+      double   wS;      // signal weight
+      double   wB;      // background weight
+   };
+
+   // one point (effB, effS) of the ROC curve
+   struct Point {
+      double effB;
+      double effS;
+   };
+
+   ScoreHistogram() : fKeyBits( 32 ), fMaxBins( 0 ), fNaN( 0 ) {}
+
+   // at most maxBins bins (0 = unlimited), see above
+   void SetMaxBins( size_t maxBins ) { fMaxBins = maxBins; Flush(); }
+
+   void Fill( float score, bool isSignal, double weight = 1 )
+   {
+      if (std::isnan( score )) {
+         fNaN++;
+         return;
+      }
+      Bin b = { Key( score ) >> (32 - fKeyBits), isSignal ? weight : 0, isSignal ? 0 : weight };
+      fBuffer.push_back( b );
+      if (fBuffer.size() >= kBufferSize) Flush();
+   }
+
+   // add the bins of other (both are brought to the coarser key resolution)
+   void Merge( ScoreHistogram& other )
+   {
+      Flush();
+      other.Flush();
+      if (other.fKeyBits < fKeyBits) Coarsen( fKeyBits - other.fKeyBits );
+      std::vector<Bin> bins( other.fBins );
+      if (fKeyBits < other.fKeyBits) Coarsen( bins, other.fKeyBits - fKeyBits );
+      MergeBins( bins );
+      fNaN += other.fNaN;
+      Limit();
+   }
+
+   // ---------------------------------------------------------------------------
+
+   double SumSignal()     { Flush(); return Sum( &Bin::wS ); }
+   double SumBackground() { Flush(); return Sum( &Bin::wB ); }
+   size_t NBins()         { Flush(); return fBins.size(); }
+   int    KeyBits() const { return fKeyBits; }
+   size_t NaNs()    const { return fNaN; }
+
+   // P(signal score > background score) + P(equal)/2
+   double AUC()
+   {
+      Flush();
+      double sumS = 0, sumB = 0, area = 0;
+      for (size_t i = 0; i < fBins.size(); i++) {
+         area += fBins[i].wS * (sumB + 0.5 * fBins[i].wB);
+         sumS += fBins[i].wS;
+         sumB += fBins[i].wB;
+      }
+      return (sumS > 0 && sumB > 0) ? area / (sumS * sumB) : 0;
+   }
+
+   // maximum |AUC - exact AUC| due to the dropped key bits (0 at full resolution)
+   double AUCErrorBound()
+   {
+      Flush();
+      if (fKeyBits == 32) return 0;
+      double sumS = 0, sumB = 0, ties = 0;
+      for (size_t i = 0; i < fBins.size(); i++) {
+         ties += fBins[i].wS * fBins[i].wB;
+         sumS += fBins[i].wS;
+         sumB += fBins[i].wB;
+      }
+      return (sumS > 0 && sumB > 0) ? 0.5 * ties / (sumS * sumB) : 0;
+   }
+
+   // ROC curve from (0, 0) to (1, 1), one point per bin, cutting at
+   // decreasing score (an event passes if its score is >= the cut)
+   std::vector<Point> Curve()
+   {
+      Flush();
+      double totS = Sum( &Bin::wS ), totB = Sum( &Bin::wB );
+      std::vector<Point> curve;
+      Point p = { 0, 0 };
+      curve.push_back( p );
+      if (totS <= 0 || totB <= 0) return curve;
+
+      double sumS = 0, sumB = 0;
+      for (size_t i = fBins.size(); i-- > 0; ) {
+         sumS += fBins[i].wS;
+         sumB += fBins[i].wB;
+         p.effB = sumB / totB;
+         p.effS = sumS / totS;
+         curve.push_back( p );
+      }
+      return curve;
+   }
+
+   // signal efficiency at background rejection 1 - effB, interpolated
+   // linearly along the tie segments of the curve
+   double SignalEfficiency( double rejection )
+   {
+      std::vector<Point> curve = Curve();
+      double effB = 1 - rejection;
+      for (size_t i = 1; i < curve.size(); i++) {
+         if (curve[i].effB < effB) continue;
+         const Point &a = curve[i-1], &b = curve[i];
+         if (b.effB == a.effB) return b.effS;
+         return a.effS + (b.effS - a.effS) * (effB - a.effB) / (b.effB - a.effB);
+      }
+      return curve.back().effS;
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // binary dump of the bins: "ROCHIST1", key bits, NaNs, number of bins, bins
+   bool Write( const std::string& fileName )
+   {
+      Flush();
+      FILE *out = fopen( fileName.c_str(), "wb" );
+      if (!out) {
+         std::cout << "==> ERROR: cannot write " << fileName << std::endl;
+         return false;
+      }
+      uint64_t header[3] = { (uint64_t) fKeyBits, (uint64_t) fNaN, (uint64_t) fBins.size() };
+      bool ok = fwrite( "ROCHIST1", 1, 8, out ) == 8 && fwrite( header, sizeof(header), 1, out ) == 1;
+      if (!fBins.empty()) ok = ok && fwrite( &fBins[0], sizeof(Bin), fBins.size(), out ) == fBins.size();
+      ok = (fclose( out ) == 0) && ok;
+      if (!ok) std::cout << "==> ERROR: cannot write " << fileName << std::endl;
+      return ok;
+   }
+
+   bool Read( const std::string& fileName )
+   {
+      FILE *in = fopen( fileName.c_str(), "rb" );
+      char magic[8];
+      uint64_t header[3];
+      if (!in || fread( magic, 1, 8, in ) != 8 || memcmp( magic, "ROCHIST1", 8 ) != 0 ||
+          fread( header, sizeof(header), 1, in ) != 1 || header[0] < 1 || header[0] > 32) {
+         std::cout << "==> ERROR: " << fileName << " is not a score histogram file" << std::endl;
+         if (in) fclose( in );
+         return false;
+      }
+      fKeyBits = header[0];
+      fNaN     = header[1];
+      fBuffer.clear();
+      fBins.resize( header[2] );
+      bool ok = fBins.empty() || fread( &fBins[0], sizeof(Bin), fBins.size(), in ) == fBins.size();
+      fclose( in );
+      if (!ok) {
+         std::cout << "==> ERROR: " << fileName << " is truncated" << std::endl;
+         fBins.clear();
+      }
+      Limit();
+      return ok;
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // order-preserving key of a float: key(a) < key(b) iff a < b
+   static uint32_t Key( float score )
+   {
+      if (score == 0) score = 0;     // -0 ties with +0
+      uint32_t u;
+      memcpy( &u, &score, sizeof(u) );
+      return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+   }
+
+private:
+
+   int               fKeyBits;    // high key bits kept
+   size_t            fMaxBins;
+   size_t            fNaN;        // scores that are NaN (not in the curve)
+   std::vector<Bin>  fBuffer;     // filled, not yet sorted
+   std::vector<Bin>  fBins;       // sorted by key, one per distinct key
+
+   double Sum( double Bin::* w ) const
+   {
+      double sum = 0;
+      for (size_t i = 0; i < fBins.size(); i++) sum += fBins[i].*w;
+      return sum;
+   }
+
+   // sort the buffer (LSD radix sort, 4 passes of 8 bits), combine equal
+   // keys and merge it into the bins
+   void Flush()
+   {
+      if (fBuffer.empty()) {
+         Limit();
+         return;
+      }
+
+      std::vector<Bin> tmp( fBuffer.size() );
+      for (int shift = 0; shift < 32; shift += 8) {
+         size_t count[257] = { 0 };
+         for (size_t i = 0; i < fBuffer.size(); i++) count[((fBuffer[i].key >> shift) & 0xff) + 1]++;
+         if (count[((fBuffer[0].key >> shift) & 0xff) + 1] == fBuffer.size()) continue;   // all equal
+         for (int d = 0; d < 256; d++) count[d+1] += count[d];
+         for (size_t i = 0; i < fBuffer.size(); i++) tmp[count[(fBuffer[i].key >> shift) & 0xff]++] = fBuffer[i];
+         fBuffer.swap( tmp );
+      }
+
+      size_t n = 0;
+      for (size_t i = 0; i < fBuffer.size(); i++) {
+         if (n > 0 && fBuffer[n-1].key == fBuffer[i].key) {
+            fBuffer[n-1].wS += fBuffer[i].wS;
+            fBuffer[n-1].wB += fBuffer[i].wB;
+         } else {
+            fBuffer[n++] = fBuffer[i];
+         }
+      }
+      fBuffer.resize( n );
+
+      MergeBins( fBuffer );
+      fBuffer.clear();
+      Limit();
+   }
+
+   // merge the sorted, distinct bins into fBins
+   void MergeBins( const std::vector<Bin>& bins )
+   {
+      std::vector<Bin> merged;
+      merged.reserve( fBins.size() + bins.size() );
+      size_t i = 0, j = 0;
+      while (i < fBins.size() || j < bins.size()) {
+         if (j == bins.size() || (i < fBins.size() && fBins[i].key < bins[j].key)) {
+            merged.push_back( fBins[i++] );
+         } else if (i == fBins.size() || bins[j].key < fBins[i].key) {
+            merged.push_back( bins[j++] );
+         } else {
+            Bin b = fBins[i++];
+            b.wS += bins[j].wS;
+            b.wB += bins[j++].wB;
+            merged.push_back( b );
+         }
+      }
+      fBins.swap( merged );
+   }
+
+   // drop nBits low key bits of sorted bins, combining the bins that fall together
+   static void Coarsen( std::vector<Bin>& bins, int nBits )
+   {
+      size_t n = 0;
+      for (size_t i = 0; i < bins.size(); i++) {
+         uint32_t key = bins[i].key >> nBits;
+         if (n > 0 && bins[n-1].key == key) {
+            bins[n-1].wS += bins[i].wS;
+            bins[n-1].wB += bins[i].wB;
+         } else {
+            bins[n] = bins[i];
+            bins[n++].key = key;
+         }
+      }
+      bins.resize( n );
+   }
+
+   void Coarsen( int nBits )
+   {
+      Coarsen( fBins, nBits );
+      for (size_t i = 0; i < fBuffer.size(); i++) fBuffer[i].key >>= nBits;
+      fKeyBits -= nBits;
+   }
+
+   // keep at most fMaxBins bins
+   void Limit()
+   {
+      while (fMaxBins > 0 && fBins.size() > fMaxBins && fKeyBits > 1) Coarsen( 1 );
+   }
+
+};
+
+// Fill h with n events (score[i], isSignal[i], weight[i], weight 0 = all 1)
+// on nThreads threads, each filling its own histogram, merged at the end
+inline void FillParallel( ScoreHistogram& h, size_t n, const float* score, const char* isSignal,
+                          const float* weight, int nThreads, size_t maxBins = 0 )
+{
+   nThreads = NumberOfThreads( nThreads );
+   std::vector<ScoreHistogram> partial( nThreads );
+   for (int i = 0; i < nThreads; i++) partial[i].SetMaxBins( maxBins );
+
+   ProcessBlocks( n, 1 << 16, nThreads, [&]( int iThread, size_t first, size_t last ) {
+      ScoreHistogram &p = partial[iThread];
+      for (size_t i = first; i < last; i++) p.Fill( score[i], isSignal[i], weight ? weight[i] : 1 );
+   } );
+
+   // pairwise merging, in parallel for the first levels
+   for (int step = 1; step < nThreads; step *= 2) {
+      std::vector<std::thread> mergers;
+      for (int i = 0; i + step < nThreads; i += 2 * step)
+         mergers.push_back( std::thread( [&, i]() { partial[i].Merge( partial[i + step] ); } ) );
+      for (size_t i = 0; i < mergers.size(); i++) mergers[i].join();
+   }
+   h.Merge( partial[0] );
+}
+
+#endif
@@ -0,0 +1,407 @@
+/// Hyperparameter scan with k-fold cross-validation of TMVA classifiers
+///
+/// For every method below, every combination of the values in its parameter
+/// grid is trained and tested K times (K-fold cross-validation: event i is in
+/// the test sample of fold i % K and in the training sample of the others).
+/// The jobs (configuration, fold) are run from a work queue on N worker
+/// processes at a time.
+///
+///     make -f Makefile_scan
+///     ./scan [-j N] [-k K] [-n events per class] [sample dir] [Methods]
+///
+/// example:
+///
+///     ./scan -j 16 -k 5 sample_worse_separation KNN BDT
+///
+/// The signal and background samples are loaded once, by the main process,
+/// before the workers are forked: all workers read the same in-memory copy
+/// (shared copy-on-write pages) instead of reading the input again.
+///
+/// For every configuration the ROC integral, the training time and the
+/// inference latency (test time per test event) are averaged over the folds
+/// and written to scan_<sample dir>.csv. The TMVA output of job n goes to
+/// scan/job_<n>.log, its weight files to scan/job_<n>/weights.
+///
+/// -----> MPPE <------  the parameter grids are set in DefineScan()
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TString.h"
+#include "TSystem.h"
+#include "TStopwatch.h"
+
+#include "TMVA/Factory.h"
+#include "TMVA/DataLoader.h"
+#include "TMVA/Tools.h"
+#include "TMVA/Types.h"
+
+#include "input_cache.h"
+
+// Method to scan: fixed options plus a grid of values per scanned option
+struct ScanMethod {
+   std::string                                        name;
+   TMVA::Types::EMVA                                  type;
+   std::string                                        fixedOptions;
+   std::vector< std::pair<std::string, std::vector<std::string> > > grid;
+};
+
+// One point of the grid of a method
+struct ScanConfig {
+   const ScanMethod *method;
+   std::string       scanned;     // e.g. "nkNN=20"
+   std::string       options;     // fixed + scanned
+};
+
+// Result of one fold of one configuration
+struct ScanResult {
+   double rocIntegral;
+   double trainTime;      // s, wall clock
+   double latency;        // s per test event
+};
+
+// Signal and background events, loaded once
+struct ScanSample {
+   std::vector<float> sig1, sig2;
+   std::vector<float> bkg1, bkg2;
+};
+
+std::vector<ScanMethod> DefineScan()
+{
+   std::vector<ScanMethod> scan;
+   ScanMethod m;
+
+   //-----> MPPE <------  grids of the options of classification.cpp
+   m.name = "KNN";
+   m.type = TMVA::Types::kKNN;
+   m.fixedOptions = "!H:SigmaFact=1.0:Kernel=Gaus:UseKernel=F:UseWeight=T:!Trim";
+   m.grid.clear();
+   m.grid.push_back( std::make_pair( "nkNN",      std::vector<std::string>{ "10", "20", "40", "80" } ) );
+   m.grid.push_back( std::make_pair( "ScaleFrac", std::vector<std::string>{ "0.6", "0.8", "1.0" } ) );
+   scan.push_back( m );
+
+   m.name = "BDT";
+   m.type = TMVA::Types::kBDT;
+   m.fixedOptions = "!H:!V:MinNodeSize=2.5%:BoostType=AdaBoost:AdaBoostBeta=0.5:UseBaggedBoost:BaggedSampleFraction=0.5:SeparationType=GiniIndex:nCuts=20";
+   m.grid.clear();
+   m.grid.push_back( std::make_pair( "NTrees",   std::vector<std::string>{ "200", "400", "850" } ) );
+   m.grid.push_back( std::make_pair( "MaxDepth", std::vector<std::string>{ "2", "3", "4" } ) );
+   scan.push_back( m );
+
+   m.name = "SVM";
+   m.type = TMVA::Types::kSVM;
+   m.fixedOptions = "Tol=0.001:VarTransform=Norm";
+   m.grid.clear();
+   m.grid.push_back( std::make_pair( "Gamma", std::vector<std::string>{ "0.1", "0.25", "0.5", "1.0" } ) );
+   scan.push_back( m );
+
+   m.name = "MLPBNN";
+   m.type = TMVA::Types::kMLP;
+   m.fixedOptions = "!H:!V:NeuronType=tanh:VarTransform=N:TestRate=5:TrainingMethod=BFGS:UseRegulator";
+   m.grid.clear();
+   m.grid.push_back( std::make_pair( "HiddenLayers", std::vector<std::string>{ "N+1", "N+5", "N+5,N" } ) );
+   m.grid.push_back( std::make_pair( "NCycles",      std::vector<std::string>{ "60", "200" } ) );
+   scan.push_back( m );
+
+   return scan;
+}
+
+// All points of the grid of method m
+std::vector<ScanConfig> ExpandGrid( const ScanMethod& m )
+{
+   std::vector<ScanConfig> configs( 1 );
+   configs[0].method = &m;
+
+   for (size_t p = 0; p < m.grid.size(); p++) {
+      std::vector<ScanConfig> expanded;
+      for (size_t c = 0; c < configs.size(); c++) {
+         for (size_t v = 0; v < m.grid[p].second.size(); v++) {
+            ScanConfig config = configs[c];
+            std::string item  = m.grid[p].first + "=" + m.grid[p].second[v];
+            config.scanned   += (config.scanned.empty() ? "" : ":") + item;
+            expanded.push_back( config );
+         }
+      }
+      configs = expanded;
+   }
+
+   for (size_t c = 0; c < configs.size(); c++)
+      configs[c].options = m.fixedOptions + ":" + configs[c].scanned;
+   return configs;
+}
+
+// Columns var1, var2 of a cached input tree
+bool LoadColumns( const std::string& txtFile, size_t nMax, std::vector<float>& v1, std::vector<float>& v2 )
+{
+   TFile *cache = 0;
+   TTree *tree  = GetCachedTree( txtFile, cache );
+   if (!tree) return false;
+
+   Float_t var1, var2;
+   tree->SetBranchAddress( "var1", &var1 );
+   tree->SetBranchAddress( "var2", &var2 );
+
+   Long64_t n = tree->GetEntries();
+   if (nMax > 0 && (Long64_t) nMax < n) n = nMax;
+   for (Long64_t i = 0; i < n; i++) {
+      tree->GetEntry( i );
+      v1.push_back( var1 );
+      v2.push_back( var2 );
+   }
+
+   cache->Close();
+   delete cache;
+   return true;
+}
+
+// Train and test one configuration on one fold (run in a worker process)
+bool RunJob( int job, const ScanConfig& config, int fold, int nFolds, const ScanSample& sample, ScanResult& result )
+{
+   TString jobName = Form( "job_%d", job );
+
+   TFile *outputFile = TFile::Open( "scan/" + jobName + ".root", "RECREATE" );
+   TMVA::Factory *factory = new TMVA::Factory( jobName, outputFile,
+                                               "!V:Silent:!Color:!DrawProgressBar:Transformations=I:AnalysisType=Classification" );
+   TMVA::DataLoader *dataloader = new TMVA::DataLoader( "scan/" + jobName );
+
+   dataloader->AddVariable( "var1", 'F' );
+   dataloader->AddVariable( "var2", 'F' );
+
+   std::vector<double> values( 2 );
+   for (size_t i = 0; i < sample.sig1.size(); i++) {
+      values[0] = sample.sig1[i];
+      values[1] = sample.sig2[i];
+      if ((int) (i % nFolds) == fold) dataloader->AddSignalTestEvent( values, 1.0 );
+      else                            dataloader->AddSignalTrainingEvent( values, 1.0 );
+   }
+   for (size_t i = 0; i < sample.bkg1.size(); i++) {
+      values[0] = sample.bkg1[i];
+      values[1] = sample.bkg2[i];
+      if ((int) (i % nFolds) == fold) dataloader->AddBackgroundTestEvent( values, 1.0 );
+      else                            dataloader->AddBackgroundTrainingEvent( values, 1.0 );
+   }
+   dataloader->PrepareTrainingAndTestTree( "", "NormMode=NumEvents:!V" );
+
+   factory->BookMethod( dataloader, config.method->type, config.method->name, config.options );
+
+   TStopwatch timer;
+   factory->TrainAllMethods();
+   timer.Stop();
+   result.trainTime = timer.RealTime();
+
+   size_t nTest = 0;
+   for (size_t i = 0; i < sample.sig1.size(); i++) nTest += ((int) (i % nFolds) == fold);
+   for (size_t i = 0; i < sample.bkg1.size(); i++) nTest += ((int) (i % nFolds) == fold);
+
+   timer.Start();
+   factory->TestAllMethods();
+   timer.Stop();
+   result.latency = timer.RealTime() / std::max<size_t>( nTest, 1 );
+
+   factory->EvaluateAllMethods();
+   result.rocIntegral = factory->GetROCIntegral( dataloader, config.method->name );
+
+   outputFile->Close();
+   delete factory;
+   delete dataloader;
+   gSystem->Unlink( "scan/" + jobName + ".root" );
+
+   return true;
+}
+
+// Run all jobs on at most nJobs worker processes; results[job] is filled
+// from the line the worker writes to its pipe
+bool RunQueue( const std::vector<ScanConfig>& configs, int nFolds, int nJobs, const ScanSample& sample,
+               std::vector<ScanResult>& results, std::vector<bool>& done )
+{
+   int nTotal = configs.size() * nFolds;
+   results.assign( nTotal, ScanResult() );
+   done.assign( nTotal, false );
+
+   std::map<pid_t, std::pair<int,int> > running;   // pid -> (job, read end of pipe)
+   int next = 0;
+
+   while (next < nTotal || !running.empty()) {
+
+      while (next < nTotal && (int) running.size() < nJobs) {
+         int job = next++;
+         int fd[2];
+         if (pipe( fd ) != 0) {
+            perror( "pipe" );
+            return false;
+         }
+
+         pid_t pid = fork();
+         if (pid == 0) {
+            close( fd[0] );
+            TString logName = Form( "scan/job_%d.log", job );
+            if (!freopen( logName, "w", stdout ) || !freopen( logName, "a", stderr )) _exit( 127 );
+
+            ScanResult r;
+            // _exit does not flush the (now fully buffered) log
+            if (!RunJob( job, configs[job / nFolds], job % nFolds, nFolds, sample, r )) {
+               fflush( stdout );
+               fflush( stderr );
+               _exit( 1 );
+            }
+
+            char line[256];
+            int len = snprintf( line, sizeof(line), "%.17g %.17g %.17g\n", r.rocIntegral, r.trainTime, r.latency );
+            fflush( stdout );
+            fflush( stderr );
+            _exit( write( fd[1], line, len ) == len ? 0 : 1 );
+         }
+         close( fd[1] );
+         if (pid < 0) {
+            perror( "fork" );
+            close( fd[0] );
+            return false;
+         }
+         running[pid] = std::make_pair( job, fd[0] );
+      }
+
+      int status = 0;
+      pid_t pid = wait( &status );
+      if (pid < 0) break;
+      if (!running.count( pid )) continue;
+
+      int job = running[pid].first;
+      int fd  = running[pid].second;
+      running.erase( pid );
+
+      char line[256] = { 0 };
+      ssize_t len = read( fd, line, sizeof(line) - 1 );
+      close( fd );
+
+      ScanResult &r = results[job];
+      if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && len > 0 &&
+          sscanf( line, "%lf %lf %lf", &r.rocIntegral, &r.trainTime, &r.latency ) == 3) {
+         done[job] = true;
+      } else {
+         std::cout << "==> ERROR: job " << job << " (" << configs[job / nFolds].method->name << " "
+                   << configs[job / nFolds].scanned << ", fold " << job % nFolds << ") failed, see scan/job_" << job << ".log" << std::endl;
+      }
+
+      int nDone = 0;
+      for (int j = 0; j < nTotal; j++) nDone += done[j];
+      std::cout << "==> " << nDone << " / " << nTotal << " jobs done" << std::endl;
+   }
+
+   return true;
+}
+
+// CSV field in double quotes, embedded quotes doubled
+std::string CsvQuote( const std::string& s )
+{
+   std::string q = "\"";
+   for (size_t i = 0; i < s.size(); i++) {
+      if (s[i] == '"') q += '"';
+      q += s[i];
+   }
+   return q + "\"";
+}
+
+int main( int argc, char** argv )
+{
+   int nJobs   = 0;
+   int nFolds  = 5;
+   size_t nMax = 0;
+   std::string sampleDir = "sample_good_separation";
+   std::map<std::string,int> Use;
+
+   for (int i = 1; i < argc; i++) {
+      std::string arg( argv[i] );
+      if      ((arg == "-j" || arg == "--jobs") && i+1 < argc) nJobs  = atoi( argv[++i] );
+      else if (arg == "-k" && i+1 < argc)                      nFolds = atoi( argv[++i] );
+      else if (arg == "-n" && i+1 < argc)                      nMax   = atol( argv[++i] );
+      else if (!gSystem->AccessPathName( arg.c_str() ))        sampleDir = arg;
+      else                                                     Use[arg] = 1;
+   }
+   if (nJobs <= 0) nJobs = std::max( 1u, std::thread::hardware_concurrency() );
+   if (nFolds < 2) {
+      std::cout << "==> ERROR: at least 2 folds needed" << std::endl;
+      return 1;
+   }
+
+   TMVA::Tools::Instance();
+
+   // the configurations to run
+   std::vector<ScanMethod> scan = DefineScan();
+   std::vector<ScanConfig> configs;
+   for (size_t m = 0; m < scan.size(); m++) {
+      if (!Use.empty() && !Use.count( scan[m].name )) continue;
+      std::vector<ScanConfig> c = ExpandGrid( scan[m] );
+      configs.insert( configs.end(), c.begin(), c.end() );
+   }
+   if (configs.empty()) {
+      std::cout << "==> ERROR: no method to scan" << std::endl;
+      return 1;
+   }
+
+   // the data, once, before forking
+   ScanSample sample;
+   if (!LoadColumns( sampleDir + "/signal.txt",     nMax, sample.sig1, sample.sig2 ) ||
+       !LoadColumns( sampleDir + "/background.txt", nMax, sample.bkg1, sample.bkg2 )) return 1;
+
+   std::cout << "==> Scanning " << configs.size() << " configurations x " << nFolds << " folds on "
+             << nJobs << " processes, " << sample.sig1.size() << " signal and " << sample.bkg1.size()
+             << " background events from " << sampleDir << std::endl;
+
+   gSystem->mkdir( "scan", kTRUE );
+
+   TStopwatch total;
+   std::vector<ScanResult> results;
+   std::vector<bool>       done;
+   if (!RunQueue( configs, nFolds, nJobs, sample, results, done )) return 1;
+   total.Stop();
+
+   // mean and standard deviation over the folds
+   std::string csvName = "scan_" + std::string( gSystem->BaseName( sampleDir.c_str() ) ) + ".csv";
+   FILE *csv = fopen( csvName.c_str(), "w" );
+   if (!csv) {
+      std::cout << "==> ERROR: cannot write " << csvName << std::endl;
+      return 1;
+   }
+   fprintf( csv, "method,options,folds,roc_integral,roc_integral_err,train_time_s,latency_us\n" );
+
+   printf( "\n%-8s %-32s %8s %8s %10s %12s\n", "Method", "Options", "ROC", "+-", "Train [s]", "Latency [us]" );
+   for (size_t c = 0; c < configs.size(); c++) {
+      double sumRoc = 0, sumRoc2 = 0, sumTrain = 0, sumLatency = 0;
+      int n = 0;
+      for (int f = 0; f < nFolds; f++) {
+         int job = c * nFolds + f;
+         if (!done[job]) continue;
+         sumRoc     += results[job].rocIntegral;
+         sumRoc2    += results[job].rocIntegral * results[job].rocIntegral;
+         sumTrain   += results[job].trainTime;
+         sumLatency += results[job].latency;
+         n++;
+      }
+      if (n == 0) continue;
+
+      double roc    = sumRoc / n;
+      double rocErr = n > 1 ? sqrt( std::max( 0.0, (sumRoc2 - n*roc*roc) / (n - 1) ) / n ) : 0;
+      // the options contain commas (HiddenLayers=N+5,N): quoted field
+      fprintf( csv, "%s,%s,%d,%.6f,%.6f,%.4f,%.4f\n", configs[c].method->name.c_str(), CsvQuote( configs[c].scanned ).c_str(),
+               n, roc, rocErr, sumTrain / n, sumLatency / n * 1e6 );
+      printf( "%-8s %-32s %8.4f %8.4f %10.2f %12.2f\n", configs[c].method->name.c_str(), configs[c].scanned.c_str(),
+              roc, rocErr, sumTrain / n, sumLatency / n * 1e6 );
+   }
+   fclose( csv );
+
+   std::cout << "\n==> Wrote " << csvName << " (" << total.RealTime() << " s)" << std::endl;
+   return 0;
+}
@@ -0,0 +1,191 @@
+/// Streaming access to signal/background samples that do not fit in memory
+///
+/// The input text files are converted once into compressed columnar trees
+/// (input_cache.h); EventStream reads such a tree sequentially, chunk by
+/// chunk, through the tree cache, so that only one chunk is in memory.
+///
+/// On top of it, the random split into training and test samples is done by
+/// reservoir sampling (algorithm R): one pass over the stream keeps a
+/// uniformly random subset of exactly k events, for any stream length, with
+/// memory for k events only. The reservoir is then divided at random into the
+/// test and training events:
+///
+///    EventStream stream;
+///    stream.Open( "sample_good_separation/signal.txt" );
+///    EventReservoir train, test;
+///    RandomSplit( stream, 15000, 5000, 1234, train, test );
+///
+/// The split only depends on the seed and on the order of the events.
+
+#ifndef STREAM_INPUT_H
+#define STREAM_INPUT_H
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TRandom3.h"
+
+#include "input_cache.h"
+
+// Sequential chunked reader of a cached input tree (var1, var2)
+class EventStream {
+
+public:
+
+   EventStream() : fFile( 0 ), fTree( 0 ), fEntry( 0 ), fVar1( 0 ), fVar2( 0 ) {}
+   ~EventStream() { Close(); }
+
+   bool Open( const std::string& txtFile )
+   {
+      Close();
+      fTree = GetCachedTree( txtFile, fFile );
+      if (!fTree) return false;
+
+      fTree->SetBranchStatus( "*", 0 );
+      fTree->SetBranchStatus( "var1", 1 );
+      fTree->SetBranchStatus( "var2", 1 );
+      fTree->SetBranchAddress( "var1", &fVar1 );
+      fTree->SetBranchAddress( "var2", &fVar2 );
+      fTree->SetCacheSize( 32 * 1024 * 1024 );   // read whole clusters at a time
+      fEntry = 0;
+      return true;
+   }
+
+   void Close()
+   {
+      if (fFile) {
+         fFile->Close();
+         delete fFile;
+      }
+      fFile = 0;
+      fTree = 0;
+   }
+
+   Long64_t GetEntries() const { return fTree ? fTree->GetEntries() : 0; }
+   Long64_t Position()   const { return fEntry; }
+   void     Rewind()           { fEntry = 0; }
+
+   // next chunk of at most maxEvents events (replacing the content of
+   // var1/var2); returns the number of events read, 0 at the end
+   size_t Next( size_t maxEvents, std::vector<float>& var1, std::vector<float>& var2 )
+   {
+      var1.clear();
+      var2.clear();
+      Long64_t nEntries = GetEntries();
+      while (var1.size() < maxEvents && fEntry < nEntries) {
+         fTree->GetEntry( fEntry++ );
+         var1.push_back( fVar1 );
+         var2.push_back( fVar2 );
+      }
+      return var1.size();
+   }
+
+private:
+
+   TFile    *fFile;
+   TTree    *fTree;
+   Long64_t  fEntry;
+   Float_t   fVar1;
+   Float_t   fVar2;
+
+};
+
+// Events kept by a reservoir, with their positions in the stream
+struct EventReservoir {
+   std::vector<Long64_t> entry;
+   std::vector<float>    var1;
+   std::vector<float>    var2;
+
+   size_t size() const { return entry.size(); }
+};
+
+// Uniform random integer in [0, n), also for n > 2^32
+inline Long64_t RandomIndex( TRandom3& rng, Long64_t n )
+{
+   ULong64_t u = ((ULong64_t) rng.Integer( 1u << 31 ) << 31) | rng.Integer( 1u << 31 );
+   return u % (ULong64_t) n;
+}
+
+// Reservoir sample (algorithm R) of k events of the whole stream
+inline void ReservoirSample( EventStream& stream, size_t k, TRandom3& rng, EventReservoir& reservoir )
+{
+   reservoir = EventReservoir();
+   reservoir.entry.reserve( k );
+   reservoir.var1.reserve( k );
+   reservoir.var2.reserve( k );
+
+   std::vector<float> v1, v2;
+   stream.Rewind();
+   Long64_t i = 0;
+   while (size_t n = stream.Next( 65536, v1, v2 )) {
+      for (size_t j = 0; j < n; j++, i++) {
+         if (reservoir.size() < k) {
+            reservoir.entry.push_back( i );
+            reservoir.var1.push_back( v1[j] );
+            reservoir.var2.push_back( v2[j] );
+         } else {
+            Long64_t r = RandomIndex( rng, i + 1 );
+            if (r < (Long64_t) k) {
+               reservoir.entry[r] = i;
+               reservoir.var1[r]  = v1[j];
+               reservoir.var2[r]  = v2[j];
+            }
+         }
+      }
+   }
+}
+
+// Disjoint random training and test samples of nTrain and nTest events (fewer
+// if the stream is shorter), both in stream order
+inline bool RandomSplit( EventStream& stream, size_t nTrain, size_t nTest, UInt_t seed,
+                         EventReservoir& train, EventReservoir& test )
+{
+   TRandom3 rng( seed );
+
+   EventReservoir all;
+   ReservoirSample( stream, nTrain + nTest, rng, all );
+   if (all.size() < nTrain + nTest) {
+      std::cout << "==> WARNING: only " << all.size() << " events for " << nTrain << " training and "
+                << nTest << " test events" << std::endl;
+      nTest = std::min( nTest, all.size() / 2 );
+   }
+
+   // random test subset of the reservoir (partial Fisher-Yates shuffle of the positions)
+   std::vector<size_t> order( all.size() );
+   for (size_t i = 0; i < order.size(); i++) order[i] = i;
+   for (size_t i = 0; i < nTest; i++) std::swap( order[i], order[i + RandomIndex( rng, order.size() - i )] );
+
+   train = EventReservoir();
+   test  = EventReservoir();
+   for (size_t i = 0; i < order.size(); i++) {
+      EventReservoir &sample = (i < nTest) ? test : train;
+      size_t j = order[i];
+      sample.entry.push_back( all.entry[j] );
+      sample.var1.push_back( all.var1[j] );
+      sample.var2.push_back( all.var2[j] );
+   }
+
+   // stream order
+   std::vector<size_t> byEntry;
+   for (int s = 0; s < 2; s++) {
+      EventReservoir &sample = s ? test : train;
+      byEntry.resize( sample.size() );
+      for (size_t i = 0; i < byEntry.size(); i++) byEntry[i] = i;
+      std::sort( byEntry.begin(), byEntry.end(), [&]( size_t a, size_t b ) { return sample.entry[a] < sample.entry[b]; } );
+      EventReservoir sorted;
+      for (size_t i = 0; i < byEntry.size(); i++) {
+         sorted.entry.push_back( sample.entry[byEntry[i]] );
+         sorted.var1.push_back( sample.var1[byEntry[i]] );
+         sorted.var2.push_back( sample.var2[byEntry[i]] );
+      }
+      sample = sorted;
+   }
+
+   return true;
+}
+
+#endif
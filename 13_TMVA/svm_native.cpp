@@ -0,0 +1,136 @@
+/// Check of the native SVM (svm_native.h) against TMVA
+///
+/// Evaluates the SVM method trained by classification.cpp on the events of a
+/// data file, with TMVA::Reader and with NativeSVM, and prints the largest
+/// difference of the responses and the time per event of both (single core).
+/// Then, for every given dimension D, the random Fourier feature
+/// approximation is set up and its maximum and RMS difference to the exact
+/// responses and its time per event are printed.
+///
+///     make -f Makefile_svm_native
+///     ./svm_native [Method] [data file] [number of events compared] [D,D,...]
+///
+/// The defaults are SVM, sample_good_separation/data.txt, 10000 events and
+/// D = 64,256,1024,4096.
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <TString.h>
+#include <TObjArray.h>
+#include <TObjString.h>
+#include <TStopwatch.h>
+
+#include <TMVA/Reader.h>
+#include <TMVA/MethodBase.h>
+
+#include "batch_eval.h"
+#include "svm_native.h"
+
+int main( int argc, char** argv )
+{
+   TString     method   = (argc > 1) ? argv[1] : "SVM";
+   std::string dataFile = (argc > 2) ? argv[2] : "sample_good_separation/data.txt";
+   size_t      nCompare = (argc > 3) ? atol( argv[3] ) : 10000;
+   TString     dims     = (argc > 4) ? argv[4] : "64,256,1024,4096";
+
+   TString weightfile = "dataset/weights/classification_" + method + ".weights.xml";
+
+   EventData data;
+   if (!LoadEventData( dataFile, data )) return 1;
+   nCompare = std::min( nCompare, data.size() );
+
+   TStopwatch timer;
+
+   // --- TMVA
+   Float_t var1, var2;
+   TMVA::Reader *reader = new TMVA::Reader( "!Color:Silent" );
+   reader->AddVariable( "var1", &var1 );
+   reader->AddVariable( "var2", &var2 );
+
+   timer.Start();
+   TMVA::MethodBase *mva = dynamic_cast<TMVA::MethodBase*>( reader->BookMVA( method + " method", weightfile ) );
+   timer.Stop();
+   if (!mva) {
+      std::cout << "==> ERROR: cannot book " << method << " from " << weightfile << std::endl;
+      return 1;
+   }
+   double tmvaLoad = timer.RealTime();
+
+   std::vector<float> tmvaOut( nCompare );
+   timer.Start();
+   for (size_t i = 0; i < nCompare; i++) {
+      var1 = data.var1[i];
+      var2 = data.var2[i];
+      tmvaOut[i] = reader->EvaluateMVA( mva );
+   }
+   timer.Stop();
+   double tmvaTime = timer.RealTime() / nCompare;
+
+   // --- native
+   NativeSVM svm;
+   timer.Start();
+   if (!svm.LoadXML( weightfile.Data() )) return 1;
+   timer.Stop();
+   double nativeLoad = timer.RealTime();
+
+   std::vector<float> nativeOut( data.size() );
+   NativeSVM::Workspace ws;
+   const float *x[2] = { &data.var1[0], &data.var2[0] };
+   timer.Start();
+   svm.EvaluateBatch( data.size(), x, &nativeOut[0], ws );
+   timer.Stop();
+   double nativeTime = timer.RealTime() / data.size();
+
+   // --- comparison
+   // (partly single precision: differences up to kTolerance are expected)
+   const double kTolerance = 1e-5;
+   double maxDiff = 0;
+   size_t nDiff   = 0;
+   for (size_t i = 0; i < nCompare; i++) {
+      double diff = fabs( tmvaOut[i] - nativeOut[i] );
+      maxDiff = std::max( maxDiff, diff );
+      if (diff > kTolerance) nDiff++;
+   }
+
+   std::cout << "==> Compared " << nCompare << " events: " << nDiff << " differ, max |difference| = " << maxDiff << std::endl;
+   std::cout << "==> Loading:  TMVA " << tmvaLoad << " s, native " << nativeLoad << " s" << std::endl;
+   std::cout << "==> Per event: TMVA " << tmvaTime * 1e6 << " us, native " << nativeTime * 1e6 << " us"
+             << " (x" << tmvaTime / std::max( nativeTime, 1e-12 ) << ", "
+             << 1e-6 / std::max( nativeTime, 1e-12 ) << " million events/s)" << std::endl;
+
+   // --- random Fourier features
+   std::vector<float> approxOut( data.size() );
+   TObjArray *list = dims.Tokenize( "," );
+   for (int i = 0; i < list->GetEntries(); i++) {
+      int D = atoi( list->At( i )->GetName() );
+      if (D <= 0) continue;
+      timer.Start();
+      svm.SetFourier( D );
+      timer.Stop();
+      double setupTime = timer.RealTime();
+
+      timer.Start();
+      svm.EvaluateBatch( data.size(), x, &approxOut[0], ws );
+      timer.Stop();
+      double approxTime = timer.RealTime() / data.size();
+
+      double approxMax = 0, sum2 = 0;
+      for (size_t j = 0; j < data.size(); j++) {
+         double diff = fabs( (double) approxOut[j] - nativeOut[j] );
+         approxMax = std::max( approxMax, diff );
+         sum2 += diff * diff;
+      }
+      std::cout << "==> Fourier D = " << D << ": max |difference| = " << approxMax << ", RMS "
+                << std::sqrt( sum2 / std::max<size_t>( data.size(), 1 ) ) << ", " << approxTime * 1e6
+                << " us per event (x" << nativeTime / std::max( approxTime, 1e-12 ) << " vs exact), setup "
+                << setupTime << " s" << std::endl;
+   }
+   delete list;
+
+   delete reader;
+   return nDiff == 0 ? 0 : 1;
+}
@@ -0,0 +1,329 @@
+/// Native batched evaluation of the TMVA SVM with Gaussian (RBF) kernel
+///
+/// Rebuilds the support vector machine booked in classification.cpp from its
+/// weight file and evaluates blocks of events at once:
+///
+///    NativeSVM svm;
+///    svm.LoadXML( "dataset/weights/classification_SVM.weights.xml" );
+///    NativeSVM::Workspace ws;                        // one per thread
+///    svm.EvaluateBatch( n, x, response, ws );         // x[v][i], v = 0..NVar-1
+///
+/// The response is the one of TMVA::MethodSVM::GetMvaValue,
+///
+///    f(x) = sum_s alpha_s y_s exp( -gamma |x_s - x|^2 ) - b,   response = 1 / (1 + exp( f ))
+///
+/// with the inputs normalized to [-1, 1] (VarTransform=Norm). The support
+/// vectors are stored as one array per variable and the kernels are computed
+/// for a block of kBlockSize events per support vector: the inner loops run
+/// over the events of the block (which stay in L1 cache) and vectorize,
+/// including the exponential (vec_math.h). Partial sums over tiles of
+/// kTileSize support vectors are single precision, the total is double;
+/// the responses agree with TMVA to about 1e-6, see svm_native.cpp.
+///
+/// The cost is still one kernel per support vector and event. SetFourier( D )
+/// switches to the random Fourier feature approximation of the kernel,
+///
+///    exp( -gamma |x - y|^2 ) ~ z(x).z(y),   z_d(x) = sqrt(2/D) cos( w_d.x + c_d ),
+///
+/// with w_d drawn from a normal distribution of variance 2 gamma per
+/// variable and c_d uniform in [0, 2pi]. The sum over the support vectors
+/// then collapses into one D-dimensional vector beta = sum_s alpha_s y_s z(x_s),
+/// computed once, and f(x) = beta.z(x) - b costs D cosines per event however
+/// many support vectors there are. The error falls as 1/sqrt(D) and depends
+/// on the model, so it has to be measured: ApproximationError compares the
+/// approximate and exact responses on a set of events.
+
+#ifndef SVM_NATIVE_H
+#define SVM_NATIVE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tmva_weights.h"
+#include "binary_model.h"
+#include "vec_math.h"
+
+class NativeSVM {
+
+public:
+
+   static const size_t kBlockSize = 256;   // events per block in EvaluateBatch
+   static const int    kTileSize  = 64;    // support vectors per single precision partial sum
+
+   // per-thread buffers of a block of events
+   struct Workspace {
+      std::vector<float>  fX;        // normalized inputs, one row of kBlockSize per variable
+      std::vector<float>  fTmp;      // squared distances, or phases
+      std::vector<float>  fPart;
+      std::vector<double> fSum;
+   };
+
+   NativeSVM() : fNVar( 0 ), fNSV( 0 ), fGamma( 0 ), fBparm( 0 ), fNFourier( 0 ) {}
+
+   // ---------------------------------------------------------------------------
+
+   bool LoadXML( const std::string& fileName )
+   {
+      TMVAWeightsFile wf;
+      if (!wf.Open( fileName )) return false;
+
+      if (wf.Method().compare( 0, 5, "SVM::" ) != 0) {
+         std::cout << "==> ERROR: " << fileName << " is not a SVM weight file" << std::endl;
+         return false;
+      }
+      if (!wf.NormalizeRanges( fNormMin, fNormMax )) return false;
+
+      // <Weights fBparm fGamma [fTheKernel] NSupVec>
+      //    <SupportVector Rows="1" Columns="NVar+4"> index alpha typeflag deltaAlpha x... </SupportVector>
+      XMLNodePointer_t weights = wf.Child( wf.Root(), "Weights" );
+      if (wf.HasAttr( weights, "fTheKernel" ) && wf.Attr( weights, "fTheKernel" ) != "RBF") {
+         std::cout << "==> ERROR: " << fileName << ": only the RBF kernel is supported, not "
+                   << wf.Attr( weights, "fTheKernel" ) << std::endl;
+         return false;
+      }
+      fBparm = wf.AttrD( weights, "fBparm" );
+      fGamma = wf.AttrD( weights, "fGamma" );
+      fNVar  = wf.Variables().size();
+      fNSV   = wf.AttrI( weights, "NSupVec" );
+
+      fSV.assign( (size_t) fNVar * fNSV, 0 );
+      fCoef.assign( fNSV, 0 );
+      size_t s = 0;
+      for (XMLNodePointer_t sv = wf.Child( weights, "SupportVector" ); sv; sv = wf.Next( sv, "SupportVector" ), s++) {
+         if (s >= (size_t) fNSV) break;
+         std::istringstream content( wf.Content( sv ) );
+         double index, alpha, typeFlag, deltaAlpha;
+         content >> index >> alpha >> typeFlag >> deltaAlpha;
+         for (int v = 0; v < fNVar; v++) content >> fSV[(size_t) v * fNSV + s];
+         if (!content) {
+            std::cout << "==> ERROR: " << fileName << ": cannot read support vector " << s << std::endl;
+            return false;
+         }
+         fCoef[s] = alpha * typeFlag;
+      }
+      if (s != (size_t) fNSV || fNVar == 0 || (!fNormMin.empty() && fNormMin.size() != (size_t) fNVar)) {
+         std::cout << "==> ERROR: " << fileName << ": inconsistent support vectors" << std::endl;
+         return false;
+      }
+      Setup();
+
+      std::cout << "==> NativeSVM: " << fNSV << " support vectors, gamma " << fGamma << ", "
+                << fNVar << " variables" << std::endl;
+      return true;
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // random Fourier features of dimension nFeatures (0 = exact kernels)
+   void SetFourier( int nFeatures, unsigned int seed = 4357 )
+   {
+      fNFourier = std::max( nFeatures, 0 );
+      fOmega.assign( (size_t) fNFourier * fNVar, 0 );
+      fPhase.assign( fNFourier, 0 );
+      fBeta.assign( fNFourier, 0 );
+      if (fNFourier == 0) return;
+
+      std::mt19937 rng( seed );
+      std::normal_distribution<float>       omega( 0, std::sqrt( 2 * fGamma ) );
+      std::uniform_real_distribution<float> phase( 0, 2 * M_PI );
+      for (int d = 0; d < fNFourier; d++) {
+         for (int v = 0; v < fNVar; v++) fOmega[(size_t) v * fNFourier + d] = omega( rng );
+         fPhase[d] = phase( rng );
+      }
+
+      // beta_d = sqrt(2/D) sum_s coef_s cos( w_d.x_s + c_d ); the sqrt(2/D)
+      // of z(x) is folded in as well
+      double norm = 2. / fNFourier;
+      for (int d = 0; d < fNFourier; d++) {
+         double sum = 0;
+         for (int s = 0; s < fNSV; s++) {
+            double arg = fPhase[d];
+            for (int v = 0; v < fNVar; v++) arg += fOmega[(size_t) v * fNFourier + d] * fSV[(size_t) v * fNSV + s];
+            sum += fCoef[s] * std::cos( arg );
+         }
+         fBeta[d] = norm * sum;
+      }
+   }
+
+   int GetNFourier() const { return fNFourier; }
+
+   // ---------------------------------------------------------------------------
+
+   // responses of n events, variable v of event i in x[v][i]
+   void EvaluateBatch( size_t n, const float* const* x, float* response, Workspace& ws ) const
+   {
+      if (ws.fX.size() < (size_t) fNVar * kBlockSize) ws.fX.resize( (size_t) fNVar * kBlockSize );
+      ws.fTmp.resize( kBlockSize );
+      ws.fPart.resize( kBlockSize );
+      ws.fSum.resize( kBlockSize );
+      float  *tmp  = &ws.fTmp[0];
+      float  *part = &ws.fPart[0];
+      double *sum  = &ws.fSum[0];
+
+      for (size_t first = 0; first < n; first += kBlockSize) {
+         size_t nb = std::min( kBlockSize, n - first );
+
+         for (int v = 0; v < fNVar; v++) {
+            const float *xv = x[v] + first;
+            float       *a  = &ws.fX[(size_t) v * kBlockSize];
+            float scale = fScale[v], offset = fOffset[v];
+            for (size_t i = 0; i < nb; i++) a[i] = xv[i] * scale + offset;
+         }
+         for (size_t i = 0; i < nb; i++) sum[i] = 0;
+
+         if (fNFourier == 0) {
+            // one support vector at a time for all events of the block,
+            // summed in single precision over tiles of kTileSize vectors
+            float mgamma = -fGamma;
+            for (int tile = 0; tile < fNSV; tile += kTileSize) {
+               for (size_t i = 0; i < nb; i++) part[i] = 0;
+               for (int s = tile; s < std::min( tile + kTileSize, fNSV ); s++) {
+                  for (size_t i = 0; i < nb; i++) tmp[i] = 0;
+                  for (int v = 0; v < fNVar; v++) {
+                     const float *a  = &ws.fX[(size_t) v * kBlockSize];
+                     float        sv = fSV[(size_t) v * fNSV + s];
+                     for (size_t i = 0; i < nb; i++) {
+                        float d = a[i] - sv;
+                        tmp[i] += d * d;
+                     }
+                  }
+                  float coef = fCoef[s];
+                  for (size_t i = 0; i < nb; i++) part[i] += coef * FastExp( mgamma * tmp[i] );
+               }
+               for (size_t i = 0; i < nb; i++) sum[i] += part[i];
+            }
+         } else {
+            for (int d = 0; d < fNFourier; d++) {
+               for (size_t i = 0; i < nb; i++) tmp[i] = fPhase[d];
+               for (int v = 0; v < fNVar; v++) {
+                  const float *a     = &ws.fX[(size_t) v * kBlockSize];
+                  float        omega = fOmega[(size_t) v * fNFourier + d];
+                  for (size_t i = 0; i < nb; i++) tmp[i] += omega * a[i];
+               }
+               double beta = fBeta[d];
+               for (size_t i = 0; i < nb; i++) sum[i] += beta * FastCos( tmp[i] );
+            }
+         }
+
+         for (size_t i = 0; i < nb; i++) response[first + i] = 1. / (1. + std::exp( sum[i] - fBparm ));
+      }
+   }
+
+   // maximum and RMS difference of the current (approximate) responses to
+   // the exact ones, for the n events of x
+   void ApproximationError( size_t n, const float* const* x, double& maxDiff, double& rms ) const
+   {
+      NativeSVM exact( *this );
+      exact.SetFourier( 0 );
+
+      Workspace ws;
+      std::vector<float> approx( n ), reference( n );
+      if (n > 0) {
+         EvaluateBatch( n, x, &approx[0], ws );
+         exact.EvaluateBatch( n, x, &reference[0], ws );
+      }
+
+      maxDiff = 0;
+      double sum2 = 0;
+      for (size_t i = 0; i < n; i++) {
+         double d = std::fabs( (double) approx[i] - reference[i] );
+         maxDiff = std::max( maxDiff, d );
+         sum2 += d * d;
+      }
+      rms = n ? std::sqrt( sum2 / n ) : 0;
+   }
+
+   // ---------------------------------------------------------------------------
+
+   // binary model file: params [gamma, b, number of support vectors],
+   // normalization ranges, support vectors (one array per variable), coefficients
+   bool WriteBinary( const std::string& fileName ) const
+   {
+      std::vector<double> params;
+      params.push_back( fGamma );
+      params.push_back( fBparm );
+      params.push_back( fNSV );
+
+      BinaryModelWriter out( BinaryModel::kSVM, fNVar );
+      out.Add( kParams,  params );
+      out.Add( kNormMin, fNormMin );
+      out.Add( kNormMax, fNormMax );
+      out.Add( kSV,      fSV );
+      out.Add( kCoef,    fCoef );
+      return out.Write( fileName );
+   }
+
+   bool LoadBinary( const std::string& fileName )
+   {
+      BinaryModel in;
+      if (!in.Open( fileName )) return false;
+      if (in.Type() != BinaryModel::kSVM) {
+         std::cout << "==> ERROR: " << fileName << " is not a SVM model" << std::endl;
+         return false;
+      }
+
+      std::vector<double> params;
+      if (!in.Get( kParams, params ) || params.size() != 3) return false;
+      fGamma = params[0];
+      fBparm = params[1];
+      fNSV   = (int) params[2];
+      fNVar  = in.NVar();
+
+      if (!in.Get( kNormMin, fNormMin ) || !in.Get( kNormMax, fNormMax ) ||
+          !in.Get( kSV, fSV ) || !in.Get( kCoef, fCoef )) return false;
+      if (fNVar == 0 || fSV.size() != (size_t) fNVar * fNSV || fCoef.size() != (size_t) fNSV ||
+          fNormMin.size() != fNormMax.size() || (!fNormMin.empty() && fNormMin.size() != (size_t) fNVar)) {
+         std::cout << "==> ERROR: " << fileName << ": inconsistent support vectors" << std::endl;
+         return false;
+      }
+      Setup();
+      return true;
+   }
+
+   int    GetNVar()  const { return fNVar; }
+   int    GetNSV()   const { return fNSV; }
+   double GetGamma() const { return fGamma; }
+
+private:
+
+   // sections of the binary model file
+   enum { kParams = 1, kNormMin, kNormMax, kSV, kCoef };
+
+   int                  fNVar;
+   int                  fNSV;
+   double               fGamma;
+   double               fBparm;
+   std::vector<float>   fSV;          // support vector s, variable v at v * fNSV + s
+   std::vector<double>  fCoef;        // alpha * type flag
+   std::vector<double>  fNormMin;     // Normalize ranges (empty: none)
+   std::vector<double>  fNormMax;
+   std::vector<float>   fScale;       // normalization as x * scale + offset
+   std::vector<float>   fOffset;
+
+   int                  fNFourier;    // random Fourier features (0: exact)
+   std::vector<float>   fOmega;       // feature d, variable v at v * fNFourier + d
+   std::vector<float>   fPhase;
+   std::vector<double>  fBeta;
+
+   void Setup()
+   {
+      fScale.assign( fNVar, 1 );
+      fOffset.assign( fNVar, 0 );
+      for (size_t v = 0; v < fNormMin.size(); v++) {
+         double range = fNormMax[v] - fNormMin[v];
+         if (range <= 0) continue;
+         fScale[v]  = 2 / range;
+         fOffset[v] = -2 * fNormMin[v] / range - 1;
+      }
+      SetFourier( 0 );
+   }
+
+};
+
+#endif
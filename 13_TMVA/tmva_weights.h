@@ -0,0 +1,167 @@
+/// Minimal reader of the TMVA weight files (dataset/weights/*.weights.xml)
+///
+/// Used by the native evaluators, which rebuild a trained classifier from
+/// its weight file without booking it in a TMVA::Reader:
+///
+///    TMVAWeightsFile wf;
+///    if (!wf.Open( "dataset/weights/classification_KNN.weights.xml" )) ...
+///    int   nkNN = atoi( wf.Option( "nkNN" ).c_str() );
+///    XMLNodePointer_t weights = wf.Child( wf.Root(), "Weights" );
+///
+/// The file layout is the one written by TMVA::MethodBase::WriteStateToXML:
+///
+///    <MethodSetup Method="KNN::KNN">
+///      <Options> <Option name="nkNN" modified="Yes">20</Option> ... </Options>
+///      <Variables NVar="2"> <Variable VarIndex="0" Expression="var1" .../> ... </Variables>
+///      <Transformations NTransformations="0"> ... </Transformations>
+///      <Weights ...> method specific </Weights>
+///    </MethodSetup>
+
+#ifndef TMVA_WEIGHTS_H
+#define TMVA_WEIGHTS_H
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TXMLEngine.h"
+
+class TMVAWeightsFile {
+
+public:
+
+   TMVAWeightsFile() : fDoc( 0 ), fRoot( 0 ) {}
+   ~TMVAWeightsFile() { Close(); }
+
+   bool Open( const std::string& fileName )
+   {
+      Close();
+      fFileName = fileName;
+      fDoc = fXML.ParseFile( fileName.c_str() );
+      if (!fDoc) {
+         std::cout << "==> ERROR: cannot parse weight file " << fileName << std::endl;
+         return false;
+      }
+      fRoot = fXML.DocGetRootElement( fDoc );
+      return true;
+   }
+
+   void Close()
+   {
+      if (fDoc) fXML.FreeDoc( fDoc );
+      fDoc  = 0;
+      fRoot = 0;
+   }
+
+   const std::string& FileName() const { return fFileName; }
+
+   // <MethodSetup> element, and its Method attribute ("KNN::KNN")
+   XMLNodePointer_t Root() const { return fRoot; }
+   std::string Method() const { return Attr( fRoot, "Method" ); }
+
+   // first child of node named name (any child if name is 0), or 0
+   XMLNodePointer_t Child( XMLNodePointer_t node, const char* name = 0 ) const
+   {
+      XMLNodePointer_t child = node ? fXML.GetChild( node ) : 0;
+      while (child && name && std::string( fXML.GetNodeName( child ) ) != name) child = fXML.GetNext( child );
+      return child;
+   }
+
+   // next sibling of node named name (any sibling if name is 0), or 0
+   XMLNodePointer_t Next( XMLNodePointer_t node, const char* name = 0 ) const
+   {
+      XMLNodePointer_t next = fXML.GetNext( node );
+      while (next && name && std::string( fXML.GetNodeName( next ) ) != name) next = fXML.GetNext( next );
+      return next;
+   }
+
+   std::string Name( XMLNodePointer_t node ) const { return fXML.GetNodeName( node ); }
+
+   bool HasAttr( XMLNodePointer_t node, const char* name ) const { return fXML.HasAttr( node, name ); }
+
+   std::string Attr( XMLNodePointer_t node, const char* name ) const
+   {
+      const char *value = fXML.GetAttr( node, name );
+      return value ? value : "";
+   }
+
+   double AttrD( XMLNodePointer_t node, const char* name ) const { return atof( Attr( node, name ).c_str() ); }
+   int    AttrI( XMLNodePointer_t node, const char* name ) const { return atoi( Attr( node, name ).c_str() ); }
+
+   std::string Content( XMLNodePointer_t node ) const
+   {
+      const char *content = fXML.GetNodeContent( node );
+      return content ? content : "";
+   }
+
+   // value of <Option name="name"> in <Options>, "" if not present
+   std::string Option( const std::string& name ) const
+   {
+      for (XMLNodePointer_t opt = Child( Child( fRoot, "Options" ), "Option" ); opt; opt = Next( opt, "Option" ))
+         if (Attr( opt, "name" ) == name) return Content( opt );
+      return "";
+   }
+
+   // boolean option: "T"/"True"/"1" (TMVA writes booleans as T/F)
+   bool OptionB( const std::string& name ) const
+   {
+      std::string value = Option( name );
+      return value == "T" || value == "True" || value == "true" || value == "1";
+   }
+
+   // input variable expressions, in VarIndex order
+   std::vector<std::string> Variables() const
+   {
+      std::vector<std::string> vars;
+      for (XMLNodePointer_t var = Child( Child( fRoot, "Variables" ), "Variable" ); var; var = Next( var, "Variable" ))
+         vars.push_back( Attr( var, "Expression" ) );
+      return vars;
+   }
+
+   // x' = 2 (x - min) / (max - min) - 1 of the Normalize transformation
+   // (VarTransform=N), with the ranges of all classes. Empty min/max if the
+   // inputs are not transformed; false for other transformations.
+   bool NormalizeRanges( std::vector<double>& min, std::vector<double>& max ) const
+   {
+      min.clear();
+      max.clear();
+      XMLNodePointer_t trafos = Child( fRoot, "Transformations" );
+      int nTrafos = AttrI( trafos, "NTransformations" );
+      if (nTrafos == 0) return true;
+
+      XMLNodePointer_t trafo = Child( trafos, "Transform" );
+      if (nTrafos > 1 || Attr( trafo, "Name" ) != "Normalize") {
+         std::cout << "==> ERROR: " << fFileName << ": only the Normalize input transformation is supported" << std::endl;
+         return false;
+      }
+
+      // one <Class> per class and a last one for all classes together
+      XMLNodePointer_t all = 0;
+      for (XMLNodePointer_t cls = Child( trafo, "Class" ); cls; cls = Next( cls, "Class" )) all = cls;
+      for (XMLNodePointer_t range = Child( Child( all, "Ranges" ), "Range" ); range; range = Next( range, "Range" )) {
+         size_t index = AttrI( range, "Index" );
+         if (index >= min.size()) {
+            min.resize( index + 1, 0 );
+            max.resize( index + 1, 0 );
+         }
+         min[index] = AttrD( range, "Min" );
+         max[index] = AttrD( range, "Max" );
+      }
+      if (min.size() != Variables().size()) {
+         std::cout << "==> ERROR: " << fFileName << ": Normalize ranges do not match the variables" << std::endl;
+         return false;
+      }
+      return true;
+   }
+
+private:
+
+   mutable TXMLEngine fXML;      // its accessors are not const
+   XMLDocPointer_t    fDoc;
+   XMLNodePointer_t   fRoot;
+   std::string        fFileName;
+
+};
+
+#endif
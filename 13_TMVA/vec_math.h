@@ -0,0 +1,100 @@
+/// Branch-free single precision exp and tanh for the native evaluators
+///
+/// std::exp and std::tanh are library calls, which stop the compiler from
+/// vectorizing the loops over the events of a block. FastExp and FastTanh
+/// use only arithmetic, min/max and integer bit manipulation, so loops like
+///
+///    for (size_t i = 0; i < n; i++) y[i] = FastTanh( y[i] );
+///
+/// compile to SIMD instructions (-O3 -fno-trapping-math: with trapping math
+/// GCC does not turn the float comparisons of the clamps into selects).
+///
+///  - FastExp: range reduction x = n ln2 + r, |r| <= ln2/2, and the degree 6
+///    polynomial of the Cephes expf; relative error below 2e-7 for x in
+///    [-87, 88], arguments outside are clamped (no inf, no denormals).
+///  - FastTanh: 1 - 2 / (exp(2|x|) + 1) with the sign of x; absolute error
+///    below 3e-7 (|x| > 9 gives +-1).
+///  - PadeTanh: the tanh of TMVA::TActivationTanh (fFAST, its default), the
+///    [7/6] Pade approximant x (135135 + 17325 x^2 + 378 x^4 + x^6) /
+///    (135135 + 62370 x^2 + 3150 x^4 + 28 x^6), +-1 for |x| > 4.97. It is
+///    not the exact tanh (error up to 1e-4 near |x| = 4.97), the MLP
+///    networks must use it to give the TMVA responses.
+///  - FastCos: reduction to a quarter period, cos(x) = -sin(2 pi (|y| - 1/4))
+///    with y = x / 2pi - round( x / 2pi ), and the Taylor series of sin to
+///    degree 11; absolute error below 1e-6 for |x| < 10, growing as
+///    |x| * 1e-7 beyond (single precision reduction).
+
+#ifndef VEC_MATH_H
+#define VEC_MATH_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+inline float FastExp( float x )
+{
+   x = (x < -87.f) ? -87.f : x;
+   x = (x >  88.f) ?  88.f : x;
+
+   // n = round( x / ln2 ), by the 1.5 * 2^23 trick (no call to rint)
+   float n = (x * 1.44269504088896341f + 12582912.f) - 12582912.f;
+   float r = x - n * 0.693359375f;
+   r = r + n * 2.12194440e-4f;
+
+   float p = 1.9875691500e-4f;
+   p = p * r + 1.3981999507e-3f;
+   p = p * r + 8.3334519073e-3f;
+   p = p * r + 4.1665795894e-2f;
+   p = p * r + 1.6666665459e-1f;
+   p = p * r + 5.0000001201e-1f;
+   float y = p * r * r + r + 1.f;
+
+   // times 2^n, built in the exponent bits
+   uint32_t bits = (uint32_t) ((int32_t) n + 127) << 23;
+   float scale;
+   memcpy( &scale, &bits, sizeof(scale) );
+   return y * scale;
+}
+
+inline float FastTanh( float x )
+{
+   float ax = std::fabs( x );
+   ax = (ax > 9.f) ? 9.f : ax;
+   float t  = 1.f - 2.f / (FastExp( 2.f * ax ) + 1.f);
+   return std::copysign( t, x );
+}
+
+inline float PadeTanh( float x )
+{
+   float c  = (x < -5.f) ? -5.f : x;                   // no overflow, the result is +-1 there
+   c = (c > 5.f) ? 5.f : c;
+   float x2 = c * c;
+   float a  = c * (135135.f + x2 * (17325.f + x2 * (378.f + x2)));
+   float b  = 135135.f + x2 * (62370.f + x2 * (3150.f + x2 * 28.f));
+   float t  = a / b;
+   t = (x >  4.97f) ?  1.f : t;
+   t = (x < -4.97f) ? -1.f : t;
+   return t;
+}
+
+inline float FastSigmoid( float x )
+{
+   return 1.f / (1.f + FastExp( -x ));
+}
+
+inline float FastCos( float x )
+{
+   float y = x * 0.159154943091895336f;                  // x / 2pi
+   y = y - ((y + 12582912.f) - 12582912.f);              // in [-1/2, 1/2]
+   float u = (std::fabs( y ) - 0.25f) * 6.28318530717958648f;   // in [-pi/2, pi/2]
+   float u2 = u * u;
+
+   float p = -2.5052108385e-8f;
+   p = p * u2 + 2.7557319224e-6f;
+   p = p * u2 - 1.9841269841e-4f;
+   p = p * u2 + 8.3333333333e-3f;
+   p = p * u2 - 1.6666666667e-1f;
+   return -(u + u * u2 * p);
+}
+
+#endif